@@ -36,6 +36,8 @@ namespace ABI {
 TIALUTILITY_EXPORT std::string demangle(const std::string &name);
 TIALUTILITY_EXPORT std::type_index currentExceptionType();
 TIALUTILITY_EXPORT void currentStackTrace(std::function<void(const std::string&)>, unsigned int skipLevels = 0);
+// async-signal-safe: raw frames, not demangled, written straight to the descriptor
+TIALUTILITY_EXPORT void writeStackTrace(int descriptor, unsigned int skipLevels = 0);
 
 }
 }
@@ -0,0 +1,130 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#include "TialUtilityExport.hpp"
+#include "Exception.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#define TIAL_MODULE "Tial::Utility::ConcurrentQueue"
+
+namespace Tial {
+namespace Utility {
+
+// Bounded lock-free queue (D. Vyukov's sequence-numbered ring). Any number of threads may push and pop;
+// capacity is rounded up to a power of two.
+template<typename T>
+class ConcurrentQueue {
+	static constexpr std::size_t cacheLine = 64;
+
+	struct Cell {
+		std::atomic<std::size_t> sequence;
+		T value;
+	};
+
+	std::unique_ptr<Cell[]> cells;
+	std::size_t mask;
+
+	char padding0[cacheLine];
+	std::atomic<std::size_t> enqueuePosition{0};
+	char padding1[cacheLine - sizeof(std::atomic<std::size_t>)];
+	std::atomic<std::size_t> dequeuePosition{0};
+	char padding2[cacheLine - sizeof(std::atomic<std::size_t>)];
+
+	static std::size_t roundCapacity(std::size_t capacity) {
+		if(capacity == 0)
+			THROW Exception("Queue capacity must be greater than zero");
+		std::size_t result = 1;
+		while(result < capacity)
+			result <<= 1;
+		return result;
+	}
+
+public:
+	explicit ConcurrentQueue(std::size_t capacity): mask(roundCapacity(capacity) - 1) {
+		cells.reset(new Cell[mask + 1]);
+		for(std::size_t i = 0; i <= mask; ++i)
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	ConcurrentQueue(const ConcurrentQueue &) = delete;
+	ConcurrentQueue &operator=(const ConcurrentQueue &) = delete;
+
+	std::size_t capacity() const {
+		return mask + 1;
+	}
+
+	bool push(T &&value) {
+		std::size_t position = enqueuePosition.load(std::memory_order_relaxed);
+		Cell *cell;
+		for(;;) {
+			cell = &cells[position & mask];
+			std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+			if(difference == 0) {
+				if(enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					break;
+			} else if(difference < 0) {
+				return false;
+			} else {
+				position = enqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+		cell->value = std::move(value);
+		cell->sequence.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T &value) {
+		std::size_t position = dequeuePosition.load(std::memory_order_relaxed);
+		Cell *cell;
+		for(;;) {
+			cell = &cells[position & mask];
+			std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+			if(difference == 0) {
+				if(dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					break;
+			} else if(difference < 0) {
+				return false;
+			} else {
+				position = dequeuePosition.load(std::memory_order_relaxed);
+			}
+		}
+		value = std::move(cell->value);
+		cell->sequence.store(position + mask + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool empty() const {
+		return enqueuePosition.load(std::memory_order_acquire) == dequeuePosition.load(std::memory_order_acquire);
+	}
+};
+
+}
+}
+
+#undef TIAL_MODULE
@@ -23,15 +23,23 @@
 #pragma once
 #include "TialUtilityExport.hpp"
 #include "Language.hpp"
+#include "Time.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <sstream>
 #include <string>
 #include <typeindex>
 #include <typeinfo>
+#include <type_traits>
+#include <vector>
 #include <experimental/string_view>
 
 namespace Tial {
@@ -50,13 +58,156 @@ enum class Level: uint8_t {
 
 std::ostream &operator<<(std::ostream &os, Level level);
 
+// Typed key-value pairs attached to a message. Values are kept in binary form, in insertion order, and
+// formatted only by handlers that output them.
+class TIALUTILITY_EXPORT Fields {
+public:
+	enum class Type: uint8_t {
+		Signed,
+		Unsigned,
+		Floating,
+		Boolean,
+		String
+	};
+
+	struct Field {
+		std::experimental::string_view key;
+		Type type;
+		union {
+			int64_t signedValue;
+			uint64_t unsignedValue;
+			double floatingValue;
+			bool booleanValue;
+		};
+		std::experimental::string_view stringValue;
+	};
+
+private:
+	// per field: type, 16-bit key length, key, then 8 bytes of value or a 32-bit length and the string;
+	// kept inside the object while it fits
+	char local[96];
+	std::unique_ptr<char[]> heap;
+	char *data = local;
+	std::size_t size = 0;
+	std::size_t capacity = sizeof(local);
+
+	void append(const void *bytes, std::size_t length);
+	void key(Type type, const std::experimental::string_view &key);
+
+	template<typename T>
+	T read(std::size_t &offset) const {
+		T value;
+		std::memcpy(&value, data + offset, sizeof(value));
+		offset += sizeof(value);
+		return value;
+	}
+
+public:
+	Fields() = default;
+	Fields(const Fields&) = delete;
+	Fields &operator=(const Fields&) = delete;
+	Fields &operator=(Fields &&other);
+
+	bool empty() const {
+		return size == 0;
+	}
+
+	void add(const std::experimental::string_view &key, int64_t value);
+	void add(const std::experimental::string_view &key, uint64_t value);
+	void add(const std::experimental::string_view &key, double value);
+	void add(const std::experimental::string_view &key, bool value);
+	void add(const std::experimental::string_view &key, const std::experimental::string_view &value);
+
+	// calls function with each field; the views are valid until the fields are modified or destroyed
+	template<typename Function>
+	void forEach(Function &&function) const {
+		std::size_t offset = 0;
+		while(offset < size) {
+			Field field;
+			field.type = read<Type>(offset);
+			uint16_t keyLength = read<uint16_t>(offset);
+			field.key = std::experimental::string_view(data + offset, keyLength);
+			offset += keyLength;
+			if(field.type == Type::String) {
+				uint32_t length = read<uint32_t>(offset);
+				field.stringValue = std::experimental::string_view(data + offset, length);
+				offset += length;
+			} else {
+				field.unsignedValue = read<uint64_t>(offset);
+			}
+			function(field);
+		}
+	}
+};
+
+// Message text. Written into a per-thread buffer while it fits; larger messages, streams of nested messages
+// and moved-from streams (e.g. queued by the asynchronous writer) use heap storage instead.
 class TIALUTILITY_EXPORT Stream {
-	std::ostringstream oss;
+	char *data = nullptr;
+	std::size_t size = 0;
+	std::size_t capacity = 0;
+	bool local = false;
+
+	void reserve(std::size_t required);
+	void release();
+
 public:
+	Stream() = default;
+	Stream(Stream &&other);
+	~Stream();
+	Stream(const Stream&) = delete;
+	Stream &operator=(const Stream&) = delete;
+
 	operator bool() const;
 	std::string output() const;
+	// valid until the stream is modified or destroyed
+	std::experimental::string_view view() const;
+	void append(const char *text, std::size_t length);
+
+	// structured values, stored apart from the text
+	Fields fields;
+
+	template<typename T>
+	typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, Stream&>::type
+	kv(const std::experimental::string_view &key, T value) {
+		fields.add(key, static_cast<int64_t>(value));
+		return *this;
+	}
+
+	template<typename T>
+	typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value && !std::is_same<T, bool>::value, Stream&>::type
+	kv(const std::experimental::string_view &key, T value) {
+		fields.add(key, static_cast<uint64_t>(value));
+		return *this;
+	}
+
+	template<typename T>
+	typename std::enable_if<std::is_floating_point<T>::value, Stream&>::type
+	kv(const std::experimental::string_view &key, T value) {
+		fields.add(key, static_cast<double>(value));
+		return *this;
+	}
+
+	Stream &kv(const std::experimental::string_view &key, bool value) {
+		fields.add(key, value);
+		return *this;
+	}
+
+	Stream &kv(const std::experimental::string_view &key, const std::experimental::string_view &value) {
+		fields.add(key, value);
+		return *this;
+	}
+
+	Stream &kv(const std::experimental::string_view &key, const std::string &value) {
+		fields.add(key, std::experimental::string_view(value));
+		return *this;
+	}
+
+	Stream &kv(const std::experimental::string_view &key, const char *value) {
+		fields.add(key, std::experimental::string_view(value));
+		return *this;
+	}
 
-	friend class Message;
 	friend TIALUTILITY_EXPORT Stream &operator<<(Stream &s, const char *string);
 	friend TIALUTILITY_EXPORT Stream &operator<<(Stream &s, int value);
 	friend TIALUTILITY_EXPORT Stream &operator<<(Stream &s, unsigned int value);
@@ -120,65 +271,555 @@ Stream &operator<<(Stream &s, const std::chrono::duration<Rep, Period> &duration
 	return s;
 }
 
+// constant metadata of a single logging statement; logging macros keep one static instance per call site
+struct Site {
+	std::experimental::string_view file;
+	unsigned int line;
+	std::experimental::string_view function;
+	std::experimental::string_view prettyFunction;
+	std::experimental::string_view module;
+
+	// levels generation in upper bits, lowest level to log in the lowest byte: the effective level of the
+	// module or the lowest level any handler accepts, whichever is higher
+	mutable std::atomic<uint64_t> threshold{0};
+	// routing generation in upper bits, index of the module's route in the lower 16 bits
+	mutable std::atomic<uint64_t> route{0};
+};
+
 class TIALUTILITY_EXPORT Message {
+	bool pending = true;
 public:
 	typedef std::chrono::time_point<std::chrono::system_clock> TimePoint;
 
 	Stream stream;
-	std::string file;
-	unsigned int line;
-	std::string function;
-	std::string prettyFunction;
+	const Site *site;
 	Level level;
-	std::string module;
 	TimePoint time;
+	std::string thread;
 
-	Message(const std::experimental::string_view &file, unsigned int line, const std::experimental::string_view &function,
-		const std::experimental::string_view &prettyFunction, Level level, const std::experimental::string_view &module,
-		const TimePoint &time);
+	// %time text, formatted by the first Layout that needs it and reused by the others
+	mutable char formattedTime[Time::maxTimestampLength];
+	mutable std::size_t formattedTimeLength = 0;
+
+	// site must outlive the message and every handler it is dispatched to
+	Message(const Site &site, Level level, const TimePoint &time);
+	// moving detaches a message: neither object is dispatched to handlers when destroyed
+	Message(Message &&other);
 	~Message();
 	Stream &out();
 };
 
-constexpr bool toBeLoggedCompile(Level level) {
 #if (defined TIAL_UTILITY_LOGGER_COMPILE_LEVEL) && (TIAL_UTILITY_LOGGER_COMPILE_LEVEL > 0)
-	return static_cast<int>(level) >= TIAL_UTILITY_LOGGER_COMPILE_LEVEL;
+constexpr int defaultCompileLevel = TIAL_UTILITY_LOGGER_COMPILE_LEVEL;
 #else
-	(void)level;
-	return true;
+constexpr int defaultCompileLevel = 0;
 #endif
+
+struct ModuleCompileLevel {
+	const char *module;
+	int level;
+};
+
+// {"module", level} pairs from TIAL_UTILITY_LOGGER_MODULE_COMPILE_LEVELS, set by tial_set_common_settings
+constexpr ModuleCompileLevel moduleCompileLevels[] = {
+#ifdef TIAL_UTILITY_LOGGER_MODULE_COMPILE_LEVELS
+	TIAL_UTILITY_LOGGER_MODULE_COMPILE_LEVELS,
+#endif
+	{nullptr, 0}
+};
+
+// length of prefix when it names module or one of its "::"-separated parents, otherwise 0
+constexpr std::size_t _modulePrefixLength(const char *module, const char *prefix) {
+	std::size_t i = 0;
+	for(; prefix[i] != '\0'; ++i)
+		if(module[i] != prefix[i])
+			return 0;
+	return module[i] == '\0' || (module[i] == ':' && module[i+1] == ':') ? i : 0;
 }
 
+// level of the longest table entry naming module or one of its parents, fallback when there is none
+template<std::size_t size>
+constexpr int compileLevel(const char *module, const ModuleCompileLevel (&table)[size], int fallback) {
+	int level = fallback;
+	std::size_t longest = 0;
+	for(std::size_t i = 0; i < size; ++i) {
+		std::size_t length = table[i].module ? _modulePrefixLength(module, table[i].module) : 0;
+		if(length > longest) {
+			longest = length;
+			level = table[i].level;
+		}
+	}
+	return level;
+}
+
+constexpr int compileLevel(const char *module) {
+	return compileLevel(module, moduleCompileLevels, defaultCompileLevel);
+}
+
+// minimum of 0 or below enables every level
+constexpr bool toBeLoggedCompile(Level level, int minimum = defaultCompileLevel) {
+	return minimum <= 0 || static_cast<int>(level) >= minimum;
+}
+
+// false also when no registered handler accepts the level, so that the message is not even formatted
 TIALUTILITY_EXPORT bool toBeLoggedRuntime(Level level, const std::experimental::string_view &module);
+
+extern TIALUTILITY_EXPORT std::atomic<uint64_t> _levelsGeneration;
+TIALUTILITY_EXPORT uint64_t _updateSiteLevel(const Site &site);
+
+// same decision as above, cached in the site until any logging level changes
+inline bool toBeLoggedRuntime(Level level, const Site &site) {
+	uint64_t threshold = site.threshold.load(std::memory_order_relaxed);
+	if((threshold >> 8) != _levelsGeneration.load(std::memory_order_relaxed))
+		threshold = _updateSiteLevel(site);
+	return static_cast<uint8_t>(level) >= static_cast<uint8_t>(threshold);
+}
+
 TIALUTILITY_EXPORT void setLoggingLevel(Level level);
 TIALUTILITY_EXPORT void setLoggingLevel(Level level, const std::experimental::string_view &module);
 
+// A statement compiled with TIAL_UTILITY_LOGGER_STATIC_KEYS starts with a 5-byte jump to its branch-guarded
+// check, described by an entry it emits into the tial_logger_keys section. Level and handler changes replace
+// the jump with a no-op while the statement's level is below what its module and handlers accept, so that a
+// dormant statement costs no load or branch. Sites stay branch-guarded until the first such change.
+struct StaticKey {
+	uintptr_t code;
+	uintptr_t target;
+	const char *module;
+	uintptr_t level;
+};
+
+TIALUTILITY_EXPORT void _registerStaticKeys(const StaticKey *begin, const StaticKey *end);
+TIALUTILITY_EXPORT void _unregisterStaticKeys(const StaticKey *begin);
+// statements currently patched out; always 0 where code can not be patched
+TIALUTILITY_EXPORT std::size_t dormantSites();
+
 class TIALUTILITY_EXPORT Handler {
-	Level level;
+	std::atomic<Level> accepted;
 public:
 	explicit Handler(Level level);
+	virtual ~Handler() = default;
+	Level level() const;
+	// may be changed while other threads log, but not from inside a handler
+	void setLevel(Level level);
 	void log(const Message &message);
+	void log(const std::vector<const Message*> &messages);
 	virtual void write(const Message &message) = 0;
+	virtual void writeBatch(const std::vector<const Message*> &messages);
+	virtual void flush();
+	// called periodically by the asynchronous writer while it has nothing to write
+	virtual void idle();
+	// Called by the crash handler, possibly while another thread is inside this handler. Writes buffered data
+	// with write(2) only and returns the descriptor a crash report should be appended to, or -1.
+	// Must be async-signal-safe.
+	virtual int emergencyFlush();
 };
 
-TIALUTILITY_EXPORT void addHandler(std::unique_ptr<Handler> &&handler);
+// Handlers may be added and removed while other threads log. Neither function may be called from inside
+// a handler. A removed handler receives no messages once removeHandler returns; nullptr means it was not added.
+// A handler added with modules receives only messages of those modules and their submodules ("Tial::Utility"
+// covers "Tial::Utility::Wildcards"); without modules it receives messages of all modules.
+TIALUTILITY_EXPORT void addHandler(std::unique_ptr<Handler> &&handler, const std::vector<std::string> &modules = {});
+TIALUTILITY_EXPORT std::unique_ptr<Handler> removeHandler(Handler *handler);
+// lowest level any registered handler accepts; above Critical when there are no handlers
+TIALUTILITY_EXPORT Level acceptedLevel();
+
+// What the asynchronous writer does with a message when its queue is full. Critical and Warning messages
+// go through a separate priority lane instead, and wait for room in it whatever the policy; the writer
+// takes them first, so they may be written before messages of lower levels logged earlier.
+struct TIALUTILITY_EXPORT QueuePolicy {
+	enum class Overflow {
+		// waits for the writer
+		Block,
+		// discards the message
+		DropNewest,
+		// discards messages below level, waits for the others
+		DropBelow,
+		// writes the message to spillFileName instead of the handlers, as Handlers::File would
+		Spill
+	};
+
+	Overflow overflow;
+	Level level;
+	std::string spillFileName;
+	std::size_t priorityQueueSize;
+
+	// blocking, with a priority lane of 1024 messages
+	QueuePolicy();
+};
+
+// Both may be called while other threads log, but not from inside a handler. Disabling writes every message
+// already queued before it returns.
+TIALUTILITY_EXPORT void enableAsynchronousMode(std::size_t queueSize = 8192, const QueuePolicy &policy = QueuePolicy());
+TIALUTILITY_EXPORT void disableAsynchronousMode();
+TIALUTILITY_EXPORT void flush();
+// messages of the level discarded, or written to the spill file, by a full asynchronous queue since the start
+TIALUTILITY_EXPORT uint64_t droppedMessages(Level level);
+TIALUTILITY_EXPORT uint64_t spilledMessages(Level level);
+// Installs a handler of SIGSEGV, SIGABRT, SIGBUS, SIGILL and SIGFPE. It writes data handlers still buffer and
+// messages still queued for the asynchronous writer, appends a stack trace to standard error and to the files
+// of text handlers, then re-raises the signal. Its alternate signal stack covers the calling thread only.
+TIALUTILITY_EXPORT void installCrashHandler();
+
+// logs, for every limiter that suppressed something since the previous report, how many messages it dropped
+TIALUTILITY_EXPORT void reportSuppressed();
+// zero disables automatic reports
+TIALUTILITY_EXPORT void setSuppressionReportInterval(std::chrono::steady_clock::duration interval);
+
+// Per-site state of the *_EVERY_N, *_FIRST_N and *_RATE macros. Messages a limiter rejects are never built,
+// only counted; the counts are reported as messages from the same site by reportSuppressed(), which also
+// runs by itself on a background thread one report interval after the first message suppressed since the
+// previous report, so the counts of a storm come out even when nothing is logged after it.
+class TIALUTILITY_EXPORT Limiter {
+	std::atomic<uint64_t> suppressed{0};
+	Limiter *previous = nullptr;
+	Limiter *next = nullptr;
+
+	friend void reportSuppressed();
+
+protected:
+	// counts a rejected message; always returns false
+	bool suppress();
+
+public:
+	const Site &site;
+	const Level level;
+
+	Limiter(const Site &site, Level level);
+	~Limiter();
+	Limiter(const Limiter&) = delete;
+	Limiter &operator=(const Limiter&) = delete;
+};
+
+namespace Limiters {
+
+// accepts the first message and then every n-th one
+class EveryN: public Limiter {
+	std::atomic<uint64_t> count{0};
+public:
+	using Limiter::Limiter;
+
+	bool admit(uint64_t n) {
+		if(n > 0 && count.fetch_add(1, std::memory_order_relaxed) % n == 0)
+			return true;
+		return suppress();
+	}
+};
+
+// accepts only the first n messages
+class FirstN: public Limiter {
+	std::atomic<uint64_t> count{0};
+public:
+	using Limiter::Limiter;
+
+	bool admit(uint64_t n) {
+		if(count.load(std::memory_order_relaxed) < n && count.fetch_add(1, std::memory_order_relaxed) < n)
+			return true;
+		return suppress();
+	}
+};
+
+// token bucket holding up to one second of messages, refilled at perSecond messages per second
+class Rate: public Limiter {
+	// time at which the bucket would be full again, in steady clock nanoseconds
+	std::atomic<int64_t> full{0};
+public:
+	using Limiter::Limiter;
+
+	bool admit(uint64_t perSecond) {
+		if(perSecond > 0) {
+			const int64_t interval = std::max<int64_t>(1000000000/perSecond, 1);
+			const int64_t capacity = interval*static_cast<int64_t>(perSecond);
+			const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now().time_since_epoch()).count();
+			int64_t current = full.load(std::memory_order_relaxed);
+			for(;;) {
+				const int64_t next = std::max(current, now) + interval;
+				if(next - now > capacity)
+					break;
+				if(full.compare_exchange_weak(current, next, std::memory_order_relaxed))
+					return true;
+			}
+		}
+		return suppress();
+	}
+};
+
+}
+
+// Text form of a message, compiled from a pattern. Fields: %time (local date and time), %timestamp
+// (microseconds since epoch), %level, %thread, %module, %file, %line, %function, %msg, %fields (a space
+// and key=value for each structured field) and %% for a percent sign. %|N pads the text written since the previous %|N (or the start) with spaces to N characters.
+class TIALUTILITY_EXPORT Layout {
+public:
+	enum class Values: uint8_t {
+		// names longer than 32 characters shortened in the middle, level names padded to equal width
+		Abbreviated,
+		// complete values with backslashes, tabs and newlines escaped
+		Escaped
+	};
+
+	static constexpr char console[] = "%time %level %thread %|50%module %|30%file:%line:%function %|50%msg%fields";
+	static constexpr char file[] = "%timestamp\t%level\t%thread\t%module\t%file\t%line\t%function\t%msg%fields";
+
+private:
+	enum class Field: uint8_t {
+		Text, Time, Timestamp, Level, Thread, Module, File, Line, Function, Message, Fields, Column
+	};
+
+	struct Op {
+		Field field;
+		std::string text;
+		std::size_t width;
+	};
+
+	std::vector<Op> ops;
+	Values values;
+
+public:
+	explicit Layout(const std::string &pattern, Values values = Values::Abbreviated);
+	// appends the message, without a line terminator
+	void format(const Message &message, std::string &output) const;
+};
 
 namespace Handlers {
 
 class TIALUTILITY_EXPORT StandardOutput: public Handler {
 	std::mutex output;
 	bool colors;
+	Layout layout;
 public:
-	explicit StandardOutput(Level level, bool colors = true);
+	explicit StandardOutput(Level level, bool colors = true, const std::string &pattern = Layout::console);
 	virtual void write(const Message &message) override;
+	virtual void writeBatch(const std::vector<const Message*> &messages) override;
 };
 
 class TIALUTILITY_EXPORT File: public Handler {
+public:
+	// Buffered data is always written when the buffer is full; each enabled condition below adds a flush point.
+	// Disabling all of them leaves flushing to explicit flush() calls.
+	struct TIALUTILITY_EXPORT FlushPolicy {
+		std::size_t bytes;
+		std::chrono::milliseconds interval;
+		bool critical;
+
+		// no byte threshold, once per second and after each critical message
+		FlushPolicy();
+	};
+
+	// File name pattern is expanded again for every new segment; other threads keep logging to the current one
+	// while it is opened. Closed segments are closed, gzipped and pruned on a background thread; segments left
+	// by earlier runs of the same pattern count towards the limit.
+	struct TIALUTILITY_EXPORT RotationPolicy {
+		std::size_t bytes;
+		std::chrono::seconds interval;
+		std::size_t segments;
+		bool compress;
+
+		// no rotation
+		RotationPolicy();
+	};
+
+private:
+	class Segments;
+
 	std::mutex output;
+	std::string pattern;
 	std::string fileName;
+	FlushPolicy policy;
+	std::size_t bufferSize;
+	std::string buffer;
+	std::chrono::steady_clock::time_point lastFlush;
+	int descriptor;
+	RotationPolicy rotation;
+	std::size_t fileSize;
+	std::chrono::steady_clock::time_point opened;
+	std::unique_ptr<Segments> segments;
+	// set while one thread opens the next segment with output unlocked
+	bool rotating = false;
+
+	int open(const std::string &current, std::string &name, std::size_t &size) const;
+	void rotate(std::unique_lock<std::mutex> &lock);
+	Layout layout;
+
+	void append(const std::string &lines, bool critical);
+	void flushBuffer();
+
+protected:
+	// appends one line, including its terminator
+	virtual void formatLine(const Message &message, std::string &output) const;
+
+public:
+	explicit File(Level level, const std::string &fileName, const FlushPolicy &policy = FlushPolicy(),
+		std::size_t bufferSize = 64*1024, const RotationPolicy &rotation = RotationPolicy(),
+		const std::string &pattern = Layout::file);
+	virtual ~File();
+	std::string currentFileName();
+	virtual void write(const Message &message) override;
+	virtual void writeBatch(const std::vector<const Message*> &messages) override;
+	virtual void flush() override;
+	virtual void idle() override;
+	virtual int emergencyFlush() override;
+
+	// line in the default Layout::file pattern, terminated with a newline
+	static std::string format(const Message &message);
+};
+
+// Passes messages on to another handler, collapsing bursts of identical ones (same site, level and text):
+// the first message is written, the repeats are only counted and reported as one "last message repeated
+// N times" message when a different one arrives, when the window since the first one has passed, or on flush.
+// The window is watched by a background thread, so the report does not wait for the next message.
+class TIALUTILITY_EXPORT Deduplicate: public Handler {
+	class Timer;
+
+	std::mutex mutex;
+	std::unique_ptr<Handler> handler;
+	Message::TimePoint::duration window;
+	const Site *site = nullptr;
+	Level lastLevel = Level::Nice3;
+	std::size_t hash = 0;
+	std::string text;
+	std::string thread;
+	Message::TimePoint first;
+	Message::TimePoint last;
+	std::size_t repeats = 0;
+	std::unique_ptr<Timer> timer;
+
+	void collapse(const Message &message, std::vector<const Message*> &output, std::deque<Message> &summaries);
+	void report(std::vector<const Message*> &output, std::deque<Message> &summaries);
+	void expire();
+
+public:
+	explicit Deduplicate(Level level, std::unique_ptr<Handler> &&handler,
+		std::chrono::milliseconds window = std::chrono::seconds(1));
+	virtual ~Deduplicate();
+	virtual void write(const Message &message) override;
+	virtual void writeBatch(const std::vector<const Message*> &messages) override;
+	virtual void flush() override;
+	virtual void idle() override;
+	virtual int emergencyFlush() override;
+};
+
+// One JSON object per line, with structured fields kept typed in a nested "fields" object:
+// {"timestamp":1445000000000000,"level":"INFO","thread":"main","module":"...","file":"...","line":42,
+// "function":"...","message":"...","fields":{"latency_us":123}}
+class TIALUTILITY_EXPORT JsonLines: public File {
+protected:
+	virtual void formatLine(const Message &message, std::string &output) const override;
+
+public:
+	explicit JsonLines(Level level, const std::string &fileName, const FlushPolicy &policy = FlushPolicy(),
+		std::size_t bufferSize = 64*1024, const RotationPolicy &rotation = RotationPolicy());
+	// writes the buffer, but keeps crash reports out of the JSON
+	virtual int emergencyFlush() override;
+};
+
+// Call-site metadata and thread names are written once per file as dictionary records; every message
+// record then carries only their ids, a timestamp and the payload bytes. TialLogDecoder turns the file
+// back into Handlers::File format.
+class TIALUTILITY_EXPORT Binary: public Handler {
+public:
+	static constexpr char magic[] = "TIALLOG1";
+
+	enum class Record: uint8_t {
+		Site = 'S',
+		Thread = 'T',
+		Message = 'M'
+	};
+
+private:
+	class Dictionary;
+
+	std::mutex output;
+	std::size_t bufferSize;
+	std::string buffer;
+	int descriptor;
+	std::unique_ptr<Dictionary> dictionary;
+
+	void append(const Message &message);
+	void flushBuffer();
+
 public:
-	explicit File(Level level, const std::string &fileName);
+	explicit Binary(Level level, const std::string &fileName, std::size_t bufferSize = 64*1024);
+	virtual ~Binary();
 	virtual void write(const Message &message) override;
+	virtual void writeBatch(const std::vector<const Message*> &messages) override;
+	virtual void flush() override;
+	virtual int emergencyFlush() override;
+
+	// reads records written by Binary; each rebuilt message is detached (never dispatched to handlers)
+	static void decode(const std::string &fileName, const std::function<void(const Message&)> &callback);
+};
+
+// Keeps the newest messages in a fixed-size ring inside a memory-mapped file. Writing a message reserves
+// space with one atomic addition and copies it in, without locks or system calls; the pages belong to the
+// kernel, so they outlive a crash of the process. A ring left by a previous run with the same capacity is
+// continued rather than cleared. Usually given every level (with runtime logging at Nice3) next to
+// a File handler that keeps only warnings. TialFlightRecorderDump prints a ring, oldest message first.
+class TIALUTILITY_EXPORT FlightRecorder: public Handler {
+public:
+	static constexpr char magic[] = "TIALRNG1";
+
+private:
+	struct Header;
+
+	int descriptor;
+	std::size_t capacity;
+	char *mapping;
+	Header *header;
+	char *ring;
+
+	void put(uint64_t position, const void *data, std::size_t size);
+
+public:
+	explicit FlightRecorder(Level level, const std::string &fileName, std::size_t capacity = 16*1024*1024);
+	virtual ~FlightRecorder();
+	virtual void write(const Message &message) override;
+	// schedules writing the pages to disk; not needed to survive a crash of the process, only of the system
+	virtual void flush() override;
+
+	// rebuilds the messages stored in the newest bytes of a ring (the whole ring when bytes is 0), oldest first;
+	// each rebuilt message is detached
+	static void decode(const std::string &fileName, const std::function<void(const Message&)> &callback,
+		std::size_t bytes = 0);
+};
+
+// Appends messages to a ring of fixed-size slots in POSIX shared memory, which any number of processes may
+// write to at once. A slot is claimed with a compare-and-swap on the shared head and committed with a release
+// store of its sequence number; nothing blocks, a message that finds the ring full is counted as dropped.
+// A single Collector (see TialLogCollector) drains the ring in order into ordinary handlers. Whichever side
+// opens the ring first creates it with the given geometry; it stays until remove() is called.
+class TIALUTILITY_EXPORT SharedRing: public Handler {
+public:
+	static constexpr char magic[] = "TIALSHM2";
+
+	class Segment;
+
+	class TIALUTILITY_EXPORT Collector {
+		class State;
+		std::unique_ptr<State> state;
+	public:
+		explicit Collector(const std::string &name, std::size_t slots = 4096, std::size_t slotSize = 1024);
+		~Collector();
+		// Passes up to limit committed messages, oldest first, to handler in one batch and returns their
+		// number. Thread names are prefixed with the id of the writing process. A slot left uncommitted for
+		// a second (its writer died or stalled) is skipped and counted as dropped; writers reuse it only after
+		// the stalled one finished with it, or once its process is gone (all writers share a PID namespace).
+		std::size_t drain(Handler &handler, std::size_t limit = 256);
+		uint64_t dropped() const;
+	};
+
+private:
+	std::unique_ptr<Segment> segment;
+
+public:
+	explicit SharedRing(Level level, const std::string &name, std::size_t slots = 4096, std::size_t slotSize = 1024);
+	virtual ~SharedRing();
+	virtual void write(const Message &message) override;
+	// messages lost by all processes so far
+	uint64_t dropped() const;
+
+	static void remove(const std::string &name);
 };
 
 }
@@ -190,30 +831,127 @@ public:
 
 // helper macros
 
-#define TIAL_UTILITY_LOGGER_LOG_INTERNAL(file, line, function, prettyFunction, level, module) \
-	::Tial::Utility::Logger::toBeLoggedCompile(level) && \
-	::Tial::Utility::Logger::toBeLoggedRuntime(level, module) && \
-	::Tial::Utility::Logger::Message( \
-		file, line, function, prettyFunction, level, module, ::std::chrono::system_clock::now() \
-	).out()
+#if (defined TIAL_UTILITY_LOGGER_STATIC_KEYS) && (defined __linux__) && (defined __x86_64__) && (defined __GNUC__)
+#define TIAL_UTILITY_LOGGER_STATIC_KEYS_ENABLED
+
+extern "C" {
+extern const ::Tial::Utility::Logger::StaticKey __start_tial_logger_keys[] __attribute__((weak, visibility("hidden")));
+extern const ::Tial::Utility::Logger::StaticKey __stop_tial_logger_keys[] __attribute__((weak, visibility("hidden")));
+}
+
+namespace {
+
+// one per translation unit, each registering all keys of its binary; the registry counts them once
+const struct TialLoggerStaticKeys {
+	TialLoggerStaticKeys() {
+		::Tial::Utility::Logger::_registerStaticKeys(__start_tial_logger_keys, __stop_tial_logger_keys);
+	}
+
+	~TialLoggerStaticKeys() {
+		::Tial::Utility::Logger::_unregisterStaticKeys(__start_tial_logger_keys);
+	}
+} tialLoggerStaticKeys;
+
+}
+
+// The jump is 8-byte aligned, so that it is replaced with a single atomic store. Sections inherit the group
+// ("?") of the function, so that keys of discarded inline function copies are discarded with them.
+#define TIAL_UTILITY_LOGGER_STATIC_KEY_INTERNAL(level, module) \
+	__extension__ ({ \
+		__label__ _tialLoggerKeyEnabled; \
+		bool _tialLoggerKey = false; \
+		__asm__ goto( \
+			".balign 8\n\t" \
+			"1: .byte 0xe9\n\t" \
+			".long %l[_tialLoggerKeyEnabled] - (1b + 5)\n\t" \
+			".pushsection .rodata.tial_logger_modules, \"a?\", @progbits\n\t" \
+			"2: .asciz \"" module "\"\n\t" \
+			".popsection\n\t" \
+			".pushsection tial_logger_keys, \"aw?\", @progbits\n\t" \
+			".balign 8\n\t" \
+			".quad 1b, %l[_tialLoggerKeyEnabled], 2b, %c0\n\t" \
+			".popsection" \
+			: : "i"(static_cast<int>(level)) : : _tialLoggerKeyEnabled); \
+		if(false) { \
+		_tialLoggerKeyEnabled: \
+			_tialLoggerKey = true; \
+		} \
+		_tialLoggerKey; \
+	})
+#endif
+
+#define TIAL_UTILITY_LOGGER_SITE_INTERNAL(file, line, function, prettyFunction, module) \
+	[](const char *_tialLoggerFunction, const char *_tialLoggerPrettyFunction) { \
+		static const ::Tial::Utility::Logger::Site site{ \
+			file, line, _tialLoggerFunction, _tialLoggerPrettyFunction, module \
+		}; \
+		return &site; \
+	}(function, prettyFunction)
+
+#define TIAL_UTILITY_LOGGER_LOG_INTERNAL(file, line, function, prettyFunction, level, module, compileLevel) \
+	TIAL_UTILITY_LOGGER_LOG_IF_INTERNAL(file, line, function, prettyFunction, level, module, \
+		::Tial::Utility::Logger::toBeLoggedCompile(level, compileLevel))
+
+#define TIAL_UTILITY_LOGGER_LOG_IF_INTERNAL(file, line, function, prettyFunction, level, module, condition) \
+	for(const ::Tial::Utility::Logger::Site *_tialLoggerSite = (condition) ? \
+			TIAL_UTILITY_LOGGER_SITE_INTERNAL(file, line, function, prettyFunction, module) : nullptr; \
+		_tialLoggerSite && ::Tial::Utility::Logger::toBeLoggedRuntime(level, *_tialLoggerSite); \
+		_tialLoggerSite = nullptr) \
+		::Tial::Utility::Logger::Message(*_tialLoggerSite, level, ::std::chrono::system_clock::now()).out()
+
+// limiter is consulted only after the level check passes, so disabled statements are not counted as suppressed
+#define TIAL_UTILITY_LOGGER_LOG_LIMITED_INTERNAL(file, line, function, prettyFunction, level, module, compileLevel, limiterType, limit) \
+	for(const ::Tial::Utility::Logger::Site *_tialLoggerSite = ::Tial::Utility::Logger::toBeLoggedCompile(level, compileLevel) ? \
+			TIAL_UTILITY_LOGGER_SITE_INTERNAL(file, line, function, prettyFunction, module) : nullptr; \
+		_tialLoggerSite && ::Tial::Utility::Logger::toBeLoggedRuntime(level, *_tialLoggerSite) && \
+			[](const ::Tial::Utility::Logger::Site &_tialLoggerLimitedSite) -> limiterType& { \
+				static limiterType limiter(_tialLoggerLimitedSite, level); \
+				return limiter; \
+			}(*_tialLoggerSite).admit(limit); \
+		_tialLoggerSite = nullptr) \
+		::Tial::Utility::Logger::Message(*_tialLoggerSite, level, ::std::chrono::system_clock::now()).out()
+
+// evaluated by the compiler even in unoptimized builds
+#define TIAL_UTILITY_LOGGER_CURRENT_COMPILE_LEVEL \
+	(::std::integral_constant<int, ::Tial::Utility::Logger::compileLevel(TIAL_MODULE)>::value)
 
 #define TIAL_UTILITY_LOGGER_LOG(level) \
-	TIAL_UTILITY_LOGGER_LOG_INTERNAL(__FILE__, __LINE__, __FUNCTION__, TIAL_UTILITY_LANGUAGE_FUNCTION_SIGNATURE, level, TIAL_UTILITY_LANGUAGE_CURRENT_MODULE)
+	TIAL_UTILITY_LOGGER_LOG_INTERNAL(__FILE__, __LINE__, __FUNCTION__, TIAL_UTILITY_LANGUAGE_FUNCTION_SIGNATURE, level, TIAL_UTILITY_LANGUAGE_CURRENT_MODULE, TIAL_UTILITY_LOGGER_CURRENT_COMPILE_LEVEL)
+
+// level must be a constant; statements of a compiled-out level emit no key
+#ifdef TIAL_UTILITY_LOGGER_STATIC_KEYS_ENABLED
+#define TIAL_UTILITY_LOGGER_LOG_KEYED(level) \
+	TIAL_UTILITY_LOGGER_LOG_IF_INTERNAL(__FILE__, __LINE__, __FUNCTION__, TIAL_UTILITY_LANGUAGE_FUNCTION_SIGNATURE, level, TIAL_UTILITY_LANGUAGE_CURRENT_MODULE, \
+		::Tial::Utility::Logger::toBeLoggedCompile(level, TIAL_UTILITY_LOGGER_CURRENT_COMPILE_LEVEL) && \
+		TIAL_UTILITY_LOGGER_STATIC_KEY_INTERNAL(level, TIAL_MODULE))
+#else
+#define TIAL_UTILITY_LOGGER_LOG_KEYED(level) TIAL_UTILITY_LOGGER_LOG(level)
+#endif
+
+#define TIAL_UTILITY_LOGGER_LOG_LIMITED(level, limiterType, limit) \
+	TIAL_UTILITY_LOGGER_LOG_LIMITED_INTERNAL(__FILE__, __LINE__, __FUNCTION__, TIAL_UTILITY_LANGUAGE_FUNCTION_SIGNATURE, level, TIAL_UTILITY_LANGUAGE_CURRENT_MODULE, TIAL_UTILITY_LOGGER_CURRENT_COMPILE_LEVEL, limiterType, limit)
+
+#define TIAL_UTILITY_LOGGER_LOG_EVERY_N(level, n) \
+	TIAL_UTILITY_LOGGER_LOG_LIMITED(level, ::Tial::Utility::Logger::Limiters::EveryN, n)
+#define TIAL_UTILITY_LOGGER_LOG_FIRST_N(level, n) \
+	TIAL_UTILITY_LOGGER_LOG_LIMITED(level, ::Tial::Utility::Logger::Limiters::FirstN, n)
+#define TIAL_UTILITY_LOGGER_LOG_RATE(level, perSecond) \
+	TIAL_UTILITY_LOGGER_LOG_LIMITED(level, ::Tial::Utility::Logger::Limiters::Rate, perSecond)
 
 #define TIAL_UTILITY_LOGGER_LOG_CRITICAL \
-		TIAL_UTILITY_LOGGER_LOG(::Tial::Utility::Logger::Level::Critical)
+		TIAL_UTILITY_LOGGER_LOG_KEYED(::Tial::Utility::Logger::Level::Critical)
 #define TIAL_UTILITY_LOGGER_LOG_WARNING \
-		TIAL_UTILITY_LOGGER_LOG(::Tial::Utility::Logger::Level::Warning)
+		TIAL_UTILITY_LOGGER_LOG_KEYED(::Tial::Utility::Logger::Level::Warning)
 #define TIAL_UTILITY_LOGGER_LOG_INFO \
-		TIAL_UTILITY_LOGGER_LOG(::Tial::Utility::Logger::Level::Info)
+		TIAL_UTILITY_LOGGER_LOG_KEYED(::Tial::Utility::Logger::Level::Info)
 #define TIAL_UTILITY_LOGGER_LOG_DEBUG \
-		TIAL_UTILITY_LOGGER_LOG(::Tial::Utility::Logger::Level::Debug)
+		TIAL_UTILITY_LOGGER_LOG_KEYED(::Tial::Utility::Logger::Level::Debug)
 #define TIAL_UTILITY_LOGGER_LOG_NICE_1 \
-		TIAL_UTILITY_LOGGER_LOG(::Tial::Utility::Logger::Level::Nice1)
+		TIAL_UTILITY_LOGGER_LOG_KEYED(::Tial::Utility::Logger::Level::Nice1)
 #define TIAL_UTILITY_LOGGER_LOG_NICE_2 \
-		TIAL_UTILITY_LOGGER_LOG(::Tial::Utility::Logger::Level::Nice2)
+		TIAL_UTILITY_LOGGER_LOG_KEYED(::Tial::Utility::Logger::Level::Nice2)
 #define TIAL_UTILITY_LOGGER_LOG_NICE_3 \
-		TIAL_UTILITY_LOGGER_LOG(::Tial::Utility::Logger::Level::Nice3)
+		TIAL_UTILITY_LOGGER_LOG_KEYED(::Tial::Utility::Logger::Level::Nice3)
 
 // short macros
 #ifndef TIAL_UTILITY_LOGGER_DISABLE_SHORT_MACROS
@@ -226,4 +964,28 @@ public:
 #define LOGN2 TIAL_UTILITY_LOGGER_LOG_NICE_2
 #define LOGN3 TIAL_UTILITY_LOGGER_LOG_NICE_3
 
+#define LOGC_EVERY_N(n) TIAL_UTILITY_LOGGER_LOG_EVERY_N(::Tial::Utility::Logger::Level::Critical, n)
+#define LOGW_EVERY_N(n) TIAL_UTILITY_LOGGER_LOG_EVERY_N(::Tial::Utility::Logger::Level::Warning, n)
+#define LOGI_EVERY_N(n) TIAL_UTILITY_LOGGER_LOG_EVERY_N(::Tial::Utility::Logger::Level::Info, n)
+#define LOGD_EVERY_N(n) TIAL_UTILITY_LOGGER_LOG_EVERY_N(::Tial::Utility::Logger::Level::Debug, n)
+#define LOGN1_EVERY_N(n) TIAL_UTILITY_LOGGER_LOG_EVERY_N(::Tial::Utility::Logger::Level::Nice1, n)
+#define LOGN2_EVERY_N(n) TIAL_UTILITY_LOGGER_LOG_EVERY_N(::Tial::Utility::Logger::Level::Nice2, n)
+#define LOGN3_EVERY_N(n) TIAL_UTILITY_LOGGER_LOG_EVERY_N(::Tial::Utility::Logger::Level::Nice3, n)
+
+#define LOGC_FIRST_N(n) TIAL_UTILITY_LOGGER_LOG_FIRST_N(::Tial::Utility::Logger::Level::Critical, n)
+#define LOGW_FIRST_N(n) TIAL_UTILITY_LOGGER_LOG_FIRST_N(::Tial::Utility::Logger::Level::Warning, n)
+#define LOGI_FIRST_N(n) TIAL_UTILITY_LOGGER_LOG_FIRST_N(::Tial::Utility::Logger::Level::Info, n)
+#define LOGD_FIRST_N(n) TIAL_UTILITY_LOGGER_LOG_FIRST_N(::Tial::Utility::Logger::Level::Debug, n)
+#define LOGN1_FIRST_N(n) TIAL_UTILITY_LOGGER_LOG_FIRST_N(::Tial::Utility::Logger::Level::Nice1, n)
+#define LOGN2_FIRST_N(n) TIAL_UTILITY_LOGGER_LOG_FIRST_N(::Tial::Utility::Logger::Level::Nice2, n)
+#define LOGN3_FIRST_N(n) TIAL_UTILITY_LOGGER_LOG_FIRST_N(::Tial::Utility::Logger::Level::Nice3, n)
+
+#define LOGC_RATE(perSecond) TIAL_UTILITY_LOGGER_LOG_RATE(::Tial::Utility::Logger::Level::Critical, perSecond)
+#define LOGW_RATE(perSecond) TIAL_UTILITY_LOGGER_LOG_RATE(::Tial::Utility::Logger::Level::Warning, perSecond)
+#define LOGI_RATE(perSecond) TIAL_UTILITY_LOGGER_LOG_RATE(::Tial::Utility::Logger::Level::Info, perSecond)
+#define LOGD_RATE(perSecond) TIAL_UTILITY_LOGGER_LOG_RATE(::Tial::Utility::Logger::Level::Debug, perSecond)
+#define LOGN1_RATE(perSecond) TIAL_UTILITY_LOGGER_LOG_RATE(::Tial::Utility::Logger::Level::Nice1, perSecond)
+#define LOGN2_RATE(perSecond) TIAL_UTILITY_LOGGER_LOG_RATE(::Tial::Utility::Logger::Level::Nice2, perSecond)
+#define LOGN3_RATE(perSecond) TIAL_UTILITY_LOGGER_LOG_RATE(::Tial::Utility::Logger::Level::Nice3, perSecond)
+
 #endif
@@ -0,0 +1,241 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#include "TialUtilityExport.hpp"
+#include "Logger.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define TIAL_MODULE "Tial::Utility::Metrics"
+
+namespace Tial {
+namespace Utility {
+
+// Numeric instrumentation. Metrics register themselves under a module and a name for as long as they exist,
+// usually as static objects; updates are wait-free, reading sums the per-thread shards.
+namespace Metrics {
+
+constexpr std::size_t shardCount = 16;
+
+TIALUTILITY_EXPORT unsigned int _nextShard();
+
+// threads are spread over the shards in order of their first update
+inline std::size_t _shard() {
+	static thread_local const std::size_t shard = _nextShard() % shardCount;
+	return shard;
+}
+
+enum class Kind {
+	Counter,
+	Gauge,
+	Histogram
+};
+
+// distribution of values over power-of-two buckets: 0, 1, 2-3, 4-7, ...
+struct TIALUTILITY_EXPORT Distribution {
+	static constexpr std::size_t bucketCount = 65;
+
+	uint64_t count = 0;
+	uint64_t sum = 0;
+	uint64_t buckets[bucketCount] = {};
+
+	static std::size_t bucket(uint64_t value) {
+		return value == 0 ? 0 : 64 - __builtin_clzll(value);
+	}
+
+	// upper bound of the bucket holding the given fraction of values; 0 when empty
+	uint64_t percentile(double fraction) const;
+};
+
+struct Sample {
+	std::string module;
+	std::string name;
+	Kind kind;
+	// counter or gauge
+	int64_t value;
+	Distribution distribution;
+};
+
+class TIALUTILITY_EXPORT Metric {
+	std::string module_;
+	std::string name_;
+	Kind kind_;
+
+protected:
+	Metric(const std::string &module, const std::string &name, Kind kind);
+	// Called by the most derived class at the end of its constructor and the start of its destructor, so that
+	// snapshots never sample a partially constructed or destroyed metric.
+	void registerMetric();
+	void unregisterMetric();
+
+public:
+	virtual ~Metric();
+	Metric(const Metric&) = delete;
+	Metric &operator=(const Metric&) = delete;
+
+	const std::string &module() const {
+		return module_;
+	}
+	const std::string &name() const {
+		return name_;
+	}
+	Kind kind() const {
+		return kind_;
+	}
+
+	virtual Sample sample() const = 0;
+};
+
+class TIALUTILITY_EXPORT Counter: public Metric {
+	// one cache line per shard
+	struct Shard {
+		std::atomic<uint64_t> value{0};
+		char padding[64 - sizeof(std::atomic<uint64_t>)];
+	};
+	Shard shards[shardCount];
+
+public:
+	Counter(const std::string &module, const std::string &name);
+	~Counter();
+
+	void add(uint64_t amount = 1) {
+		shards[_shard()].value.fetch_add(amount, std::memory_order_relaxed);
+	}
+
+	uint64_t value() const;
+	virtual Sample sample() const override;
+};
+
+class TIALUTILITY_EXPORT Gauge: public Metric {
+	std::atomic<int64_t> current{0};
+
+public:
+	Gauge(const std::string &module, const std::string &name);
+	~Gauge();
+
+	void set(int64_t value) {
+		current.store(value, std::memory_order_relaxed);
+	}
+
+	void add(int64_t amount) {
+		current.fetch_add(amount, std::memory_order_relaxed);
+	}
+
+	int64_t value() const {
+		return current.load(std::memory_order_relaxed);
+	}
+
+	virtual Sample sample() const override;
+};
+
+class TIALUTILITY_EXPORT Histogram: public Metric {
+	// the count is the sum of the buckets
+	struct Shard {
+		std::atomic<uint64_t> sum{0};
+		std::atomic<uint64_t> buckets[Distribution::bucketCount] = {};
+	};
+	Shard shards[shardCount];
+
+public:
+	// records the time from its construction to its destruction, in nanoseconds
+	class Timer {
+		Histogram &histogram;
+		std::chrono::steady_clock::time_point start;
+
+	public:
+		explicit Timer(Histogram &histogram): histogram(histogram), start(std::chrono::steady_clock::now()) {}
+
+		~Timer() {
+			histogram.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count()));
+		}
+
+		Timer(const Timer&) = delete;
+		Timer &operator=(const Timer&) = delete;
+	};
+
+	Histogram(const std::string &module, const std::string &name);
+	~Histogram();
+
+	void record(uint64_t value) {
+		Shard &shard = shards[_shard()];
+		shard.sum.fetch_add(value, std::memory_order_relaxed);
+		shard.buckets[Distribution::bucket(value)].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	Distribution distribution() const;
+	virtual Sample sample() const override;
+};
+
+// samples of the metrics registered under module and its submodules, or of all metrics when it is empty,
+// ordered by module and name
+TIALUTILITY_EXPORT std::vector<Sample> snapshot(const std::string &module = std::string());
+
+// "module name value", or "module name count=... sum=... p50=... p90=... p99=..." for histograms
+TIALUTILITY_EXPORT std::string format(const Sample &sample);
+
+// Takes a snapshot every interval on its own thread, and a last one when destroyed.
+class TIALUTILITY_EXPORT Reporter {
+public:
+	using Output = std::function<void(const std::vector<Sample> &samples)>;
+
+private:
+	std::string module;
+	Output output;
+	std::chrono::milliseconds interval;
+	std::mutex mutex;
+	std::condition_variable wakeUp;
+	bool stopping = false;
+	std::thread thread;
+
+	void run();
+
+public:
+	Reporter(std::chrono::milliseconds interval, Output output, const std::string &module = std::string());
+	// each sample as an Info message of the "Tial::Utility::Metrics" module, with its values also as fields
+	Reporter(std::chrono::milliseconds interval, std::unique_ptr<Logger::Handler> &&handler,
+		const std::string &module = std::string());
+	// appends a timestamped line per sample
+	Reporter(std::chrono::milliseconds interval, const std::string &fileName, const std::string &module = std::string());
+	~Reporter();
+	Reporter(const Reporter&) = delete;
+	Reporter &operator=(const Reporter&) = delete;
+
+	// reports now, from the calling thread
+	void report();
+};
+
+}
+}
+}
+
+#undef TIAL_MODULE
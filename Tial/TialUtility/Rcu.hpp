@@ -0,0 +1,89 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#include "TialUtilityExport.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#define TIAL_MODULE "Tial::Utility::Rcu"
+
+namespace Tial {
+namespace Utility {
+
+// Read-copy-update. Readers access shared data inside a ReadSection without taking locks or waiting; writers
+// publish a modified copy and destroy the previous version once no read section can still refer to it.
+namespace Rcu {
+
+// marks the current thread as reading; sections may be nested
+class TIALUTILITY_EXPORT ReadSection {
+public:
+	ReadSection();
+	~ReadSection();
+	ReadSection(const ReadSection&) = delete;
+	ReadSection &operator=(const ReadSection&) = delete;
+};
+
+// waits until every read section active at the time of the call has ended; must not be called from
+// inside a read section
+TIALUTILITY_EXPORT void synchronize();
+
+template<typename T>
+class Pointer {
+	std::atomic<const T*> current;
+	std::mutex writers;
+
+public:
+	explicit Pointer(std::unique_ptr<T> value): current(value.release()) {}
+
+	~Pointer() {
+		delete current.load();
+	}
+
+	Pointer(const Pointer&) = delete;
+	Pointer &operator=(const Pointer&) = delete;
+
+	// the result may be used only until the enclosing ReadSection ends
+	const T *get() const {
+		return current.load(std::memory_order_acquire);
+	}
+
+	// function receives the current value and returns its replacement; writers are serialized
+	template<typename Function>
+	void update(Function &&function) {
+		std::unique_lock<std::mutex> lock(writers);
+		const T *previous = current.load();
+		std::unique_ptr<T> next = function(*previous);
+		current.store(next.release());
+		synchronize();
+		delete previous;
+	}
+};
+
+}
+
+}
+}
+
+#undef TIAL_MODULE
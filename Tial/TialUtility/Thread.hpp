@@ -39,6 +39,8 @@ public:
 
 TIALUTILITY_EXPORT void setName(const std::string &name);
 TIALUTILITY_EXPORT std::string name();
+// number of setName calls made by the calling thread, for copies of its name to notice a change
+TIALUTILITY_EXPORT unsigned int _nameChanges();
 
 TIALUTILITY_EXPORT void kill(const std::thread::native_handle_type &handle);
 
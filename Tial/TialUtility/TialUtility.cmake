@@ -54,16 +54,19 @@ function(tial_set_common_settings)
 
 	# Build configuration
 	set(TIAL_UTILITY_LOGGER_DEFAULT_COMPILE_LEVEL 25)
+	set(TIAL_UTILITY_TRACE_DEFAULT ON)
 	if(DEFINED CMAKE_BUILD_TYPE)
 		string(TOUPPER "${CMAKE_BUILD_TYPE}" BUILD_TYPE)
 		if(BUILD_TYPE MATCHES "DEBUG")
 			set(TIAL_UTILITY_LOGGER_DEFAULT_COMPILE_LEVEL 0)
 		elseif(BUILD_TYPE MATCHES "RELEASE")
 			set(TIAL_UTILITY_LOGGER_DEFAULT_COMPILE_LEVEL 50)
+			set(TIAL_UTILITY_TRACE_DEFAULT OFF)
 		elseif(BUILD_TYPE MATCHES "RELWITHDEBINFO")
 			set(TIAL_UTILITY_LOGGER_DEFAULT_COMPILE_LEVEL 25)
 		elseif(BUILD_TYPE MATCHES "MINSIZEREL")
 			set(TIAL_UTILITY_LOGGER_DEFAULT_COMPILE_LEVEL 50)
+			set(TIAL_UTILITY_TRACE_DEFAULT OFF)
 			find_package(SelfPackers REQUIRED)
 			if(NOT SELF_PACKER_FOR_EXECUTABLE OR NOT SELF_PACKER_FOR_SHARED_LIB)
 				message(FATAL_ERROR "Self packer not found")
@@ -78,6 +81,42 @@ function(tial_set_common_settings)
 			APPEND PROPERTY COMPILE_DEFINITIONS "TIAL_UTILITY_LOGGER_COMPILE_LEVEL=${TIAL_UTILITY_LOGGER_COMPILE_LEVEL}"
 	)
 
+	set(TIAL_UTILITY_LOGGER_MODULE_COMPILE_LEVELS "" CACHE STRING "List of module=level entries overriding the compilation stage level for these modules and their submodules, e.g. Tial::Utility::Path=25;Tial::Utility::Wildcards=25")
+	set(MODULE_COMPILE_LEVELS "")
+	foreach(ENTRY ${TIAL_UTILITY_LOGGER_MODULE_COMPILE_LEVELS})
+		string(FIND "${ENTRY}" "=" SEPARATOR REVERSE)
+		if(SEPARATOR LESS 1)
+			message(FATAL_ERROR "Invalid module compile level \"${ENTRY}\", expected module=level")
+		endif()
+		string(SUBSTRING "${ENTRY}" 0 ${SEPARATOR} MODULE)
+		math(EXPR SEPARATOR "${SEPARATOR} + 1")
+		string(SUBSTRING "${ENTRY}" ${SEPARATOR} -1 LEVEL)
+		message(STATUS "Tial logger messages of ${MODULE} below level ${LEVEL} will not be available in this build")
+		list(APPEND MODULE_COMPILE_LEVELS "{\"${MODULE}\",${LEVEL}}")
+	endforeach()
+	if(MODULE_COMPILE_LEVELS)
+		string(REPLACE ";" "," MODULE_COMPILE_LEVELS "${MODULE_COMPILE_LEVELS}")
+		set_property(DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}
+				APPEND PROPERTY COMPILE_DEFINITIONS "TIAL_UTILITY_LOGGER_MODULE_COMPILE_LEVELS=${MODULE_COMPILE_LEVELS}"
+		)
+	endif()
+
+	option(TIAL_UTILITY_LOGGER_STATIC_KEYS "Compile log statements of constant levels as jumps replaced with no-ops while their level is disabled (Linux, x86-64)" OFF)
+	if(TIAL_UTILITY_LOGGER_STATIC_KEYS)
+		set_property(DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}
+				APPEND PROPERTY COMPILE_DEFINITIONS "TIAL_UTILITY_LOGGER_STATIC_KEYS"
+		)
+	endif()
+
+	option(TIAL_UTILITY_TRACE "Compile trace spans and counters; without it they generate no code" ${TIAL_UTILITY_TRACE_DEFAULT})
+	if(TIAL_UTILITY_TRACE)
+		set_property(DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}
+				APPEND PROPERTY COMPILE_DEFINITIONS "TIAL_UTILITY_TRACE"
+		)
+	else()
+		message(STATUS "Tial trace spans and counters will not be available in this build")
+	endif()
+
 	set_property(DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}
 			APPEND PROPERTY COMPILE_DEFINITIONS "TIAL_SOURCE_BASE_DIRECTORY=\"${CMAKE_SOURCE_DIR}\""
 	)
@@ -24,14 +24,18 @@
 #include "ABI.hpp"
 #include "Algorithm.hpp"
 #include "ArgumentParser.hpp"
+#include "ConcurrentQueue.hpp"
 #include "Directory.hpp"
 #include "Exception.hpp"
 #include "Language.hpp"
 #include "Logger.hpp"
+#include "Metrics.hpp"
 #include "Path.hpp"
+#include "Rcu.hpp"
 #include "StreamOperator.hpp"
 #include "Strings.hpp"
 #include "Thread.hpp"
 #include "Time.hpp"
+#include "Trace.hpp"
 #include "TypeTraits.hpp"
 #include "Wildcards.hpp"
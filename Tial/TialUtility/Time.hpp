@@ -72,6 +72,16 @@ std::string timeCast(const TimePoint &time, Zone zone = Zone::Local) {
 	return oss.str();
 }
 
+// longest text written by formatTimestamp
+constexpr std::size_t maxTimestampLength = 32;
+
+// Writes the same text as timeCast(time, zone) to output, without terminating it, and returns its length.
+// The date and time up to seconds are cached per thread and zone, and recomputed once per second.
+TIALUTILITY_EXPORT std::size_t formatTimestamp(const std::chrono::system_clock::time_point &time, char *output,
+	Zone zone = Zone::Local);
+TIALUTILITY_EXPORT std::string formatTimestamp(const std::chrono::system_clock::time_point &time,
+	Zone zone = Zone::Local);
+
 }
 }
 }
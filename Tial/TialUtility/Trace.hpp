@@ -0,0 +1,133 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#include "TialUtilityExport.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+
+#define TIAL_MODULE "Tial::Utility::Trace"
+
+namespace Tial {
+namespace Utility {
+
+// Timeline of scoped spans and counters, recorded into per-thread buffers without locks and exported as Chrome
+// trace events (chrome://tracing, Perfetto). Names are not copied: they must be string literals or otherwise
+// outlive the export.
+namespace Trace {
+
+// set by tial_set_common_settings from the TIAL_UTILITY_TRACE option; may be overridden per file
+#ifdef TIAL_UTILITY_TRACE
+constexpr bool compiled = true;
+#else
+constexpr bool compiled = false;
+#endif
+
+enum class Phase: uint8_t {
+	Begin,
+	End,
+	Counter
+};
+
+struct Event {
+	const char *name;
+	int64_t value;
+	// nanoseconds of std::chrono::steady_clock
+	int64_t time;
+	Phase phase;
+};
+
+TIALUTILITY_EXPORT extern std::atomic<bool> _recording;
+
+inline bool recording() {
+	return _recording.load(std::memory_order_relaxed);
+}
+
+// events are recorded only between start() and stop()
+TIALUTILITY_EXPORT void start();
+TIALUTILITY_EXPORT void stop();
+
+// appends to the buffer of the calling thread
+TIALUTILITY_EXPORT void _record(const char *name, Phase phase, int64_t value = 0);
+
+// Passes every event recorded since the previous collection to function, in order within each thread, and
+// releases the buffers of threads that have exited. May run concurrently with recording threads.
+TIALUTILITY_EXPORT std::size_t collect(const std::function<void(const std::string &thread, unsigned int threadId,
+	const Event &event)> &function);
+
+// collects events and writes them as a Chrome trace event JSON document
+TIALUTILITY_EXPORT void writeChromeTrace(std::ostream &stream);
+TIALUTILITY_EXPORT void writeChromeTrace(const std::string &fileName);
+
+template<bool enabled>
+class Scope {
+	const char *name;
+	bool begun;
+
+public:
+	explicit Scope(const char *name): name(name), begun(recording()) {
+		if(begun)
+			_record(name, Phase::Begin);
+	}
+
+	// ends the span even if recording stopped inside it
+	~Scope() {
+		if(begun)
+			_record(name, Phase::End);
+	}
+
+	Scope(const Scope&) = delete;
+	Scope &operator=(const Scope&) = delete;
+};
+
+template<>
+class Scope<false> {
+public:
+	explicit Scope(const char*) {}
+	Scope(const Scope&) = delete;
+	Scope &operator=(const Scope&) = delete;
+};
+
+}
+}
+}
+
+#define TIAL_UTILITY_TRACE_CONCATENATE_INTERNAL(a, b) a##b
+#define TIAL_UTILITY_TRACE_CONCATENATE(a, b) TIAL_UTILITY_TRACE_CONCATENATE_INTERNAL(a, b)
+
+// span from this statement to the end of the enclosing scope
+#define TIAL_TRACE_SCOPE(name) \
+	::Tial::Utility::Trace::Scope<::Tial::Utility::Trace::compiled> \
+		TIAL_UTILITY_TRACE_CONCATENATE(_tialTraceScope, __LINE__)(name)
+
+// value is not evaluated unless recorded
+#define TIAL_TRACE_COUNTER(name, value) \
+	do { \
+		if(::Tial::Utility::Trace::compiled && ::Tial::Utility::Trace::recording()) \
+			::Tial::Utility::Trace::_record(name, ::Tial::Utility::Trace::Phase::Counter, value); \
+	} while(false)
+
+#undef TIAL_MODULE
@@ -0,0 +1,95 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#include <TialUtility/TialUtility.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace Tial {
+namespace Utility {
+namespace Benchmark {
+
+typedef std::chrono::steady_clock Clock;
+
+class Samples {
+	std::vector<std::uint64_t> nanoseconds;
+public:
+	void reserve(std::size_t count) {
+		nanoseconds.reserve(count);
+	}
+
+	void add(const Clock::duration &duration) {
+		nanoseconds.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+	}
+
+	void merge(const Samples &other) {
+		nanoseconds.insert(nanoseconds.end(), other.nanoseconds.begin(), other.nanoseconds.end());
+	}
+
+	std::size_t size() const {
+		return nanoseconds.size();
+	}
+
+	std::uint64_t percentile(double p) {
+		if(nanoseconds.empty())
+			return 0;
+		std::size_t index = std::min(nanoseconds.size()-1, static_cast<std::size_t>(p/100.0*nanoseconds.size()));
+		std::nth_element(nanoseconds.begin(), nanoseconds.begin()+index, nanoseconds.end());
+		return nanoseconds[index];
+	}
+};
+
+// a negative allocationsPerMessage leaves out the allocations column
+inline void report(const std::string &name, Samples &samples, const Clock::duration &total,
+		double allocationsPerMessage = -1) {
+	double seconds = std::chrono::duration<double>(total).count();
+	std::cout << std::left << std::setw(48) << name << std::right
+		<< std::setw(12) << static_cast<std::uint64_t>(seconds > 0 ? samples.size()/seconds : 0) << " msg/s"
+		<< std::setw(8) << samples.percentile(50) << " ns p50"
+		<< std::setw(8) << samples.percentile(99) << " ns p99"
+		<< std::setw(9) << samples.percentile(99.9) << " ns p99.9";
+	if(allocationsPerMessage >= 0)
+		std::cout << std::setw(7) << std::fixed << std::setprecision(2) << allocationsPerMessage << std::defaultfloat
+			<< " allocs/msg";
+	std::cout << std::endl;
+}
+
+typedef std::function<void()> Function;
+
+class Registration {
+public:
+	Registration(const std::string &name, const Function &function);
+};
+
+std::vector<std::pair<std::string, Function>> &benchmarks();
+
+}
+}
+}
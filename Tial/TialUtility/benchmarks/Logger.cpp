@@ -0,0 +1,440 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "Benchmark.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+#include <boost/algorithm/string.hpp>
+
+#define TIAL_MODULE "Tial::Utility::Logger/Benchmark"
+
+namespace {
+
+const std::string logFileName = "BenchmarkTialUtility.log";
+
+void installFileHandler() {
+	static bool installed = false;
+	if(installed)
+		return;
+	installed = true;
+	std::remove(logFileName.c_str());
+	Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Info);
+	Tial::Utility::Logger::addHandler(std::make_unique<Tial::Utility::Logger::Handlers::File>(
+		Tial::Utility::Logger::Level::Info, logFileName
+	));
+}
+
+std::string escape(std::string str) {
+	boost::algorithm::replace_all(str, "\\", "\\\\");
+	boost::algorithm::replace_all(str, "\t", "\\t");
+	boost::algorithm::replace_all(str, "\n", "\\n");
+	return str;
+}
+
+// Handlers::File as it was before keeping the descriptor open: open, append and close for every message
+class LegacyFile: public Tial::Utility::Logger::Handler {
+	std::mutex output;
+	std::string fileName;
+public:
+	LegacyFile(const std::string &fileName): Handler(Tial::Utility::Logger::Level::Nice3), fileName(fileName) {}
+
+	virtual void write(const Tial::Utility::Logger::Message &message) override {
+		std::ostringstream oss;
+		oss << std::chrono::duration_cast<std::chrono::microseconds>(message.time.time_since_epoch()).count() << "\t";
+		oss << static_cast<int>(message.level) << "\t" << escape(message.thread) << "\t" << escape(message.site->module.to_string()) << "\t";
+		oss << escape(message.site->file.to_string()) << "\t" << message.site->line << "\t" << escape(message.site->function.to_string()) << "\t";
+		oss << escape(message.stream.output());
+
+		std::unique_lock<std::mutex> lock(output);
+		std::ofstream of(fileName, std::ios::app);
+		of << oss.str() << std::endl;
+	}
+};
+
+std::vector<Tial::Utility::Logger::Message> records(unsigned int count) {
+	std::vector<Tial::Utility::Logger::Message> records;
+	records.reserve(count);
+	static const Tial::Utility::Logger::Site site{
+		__FILE__, __LINE__, __FUNCTION__, TIAL_UTILITY_LANGUAGE_FUNCTION_SIGNATURE, TIAL_UTILITY_LANGUAGE_CURRENT_MODULE
+	};
+	for(unsigned int i = 0; i < count; ++i) {
+		Tial::Utility::Logger::Message message(site, Tial::Utility::Logger::Level::Info, std::chrono::system_clock::now());
+		message.out() << "benchmark message " << i;
+		records.emplace_back(std::move(message));
+	}
+	return records;
+}
+
+void fileThroughput(const std::string &name, Tial::Utility::Logger::Handler &handler, std::size_t batchSize) {
+	const unsigned int count = 50000;
+	auto messages = records(count);
+	Tial::Utility::Benchmark::Samples samples;
+	samples.reserve(count);
+
+	std::vector<const Tial::Utility::Logger::Message*> batch;
+	auto start = Tial::Utility::Benchmark::Clock::now();
+	for(auto &&message: messages) {
+		auto begin = Tial::Utility::Benchmark::Clock::now();
+		if(batchSize <= 1) {
+			handler.log(message);
+		} else {
+			batch.push_back(&message);
+			if(batch.size() == batchSize) {
+				handler.log(batch);
+				batch.clear();
+			}
+		}
+		samples.add(Tial::Utility::Benchmark::Clock::now() - begin);
+	}
+	handler.flush();
+	Tial::Utility::Benchmark::report(name, samples, Tial::Utility::Benchmark::Clock::now() - start);
+}
+
+Tial::Utility::Benchmark::Registration fileHandler("Logger/FileHandler", [](){
+	const std::string fileName = "BenchmarkTialUtilityFile.log";
+	{
+		std::remove(fileName.c_str());
+		LegacyFile handler(fileName);
+		fileThroughput("open/append/close per message", handler, 1);
+	}
+	typedef Tial::Utility::Logger::Handlers::File File;
+	File::FlushPolicy everyMessage;
+	everyMessage.bytes = 1;
+	File::FlushPolicy explicitOnly;
+	explicitOnly.interval = std::chrono::milliseconds(0);
+	explicitOnly.critical = false;
+	for(auto &&policy: {
+		std::make_pair("persistent, flush every message", everyMessage),
+		std::make_pair("persistent, default policy", File::FlushPolicy()),
+		std::make_pair("persistent, explicit flush only", explicitOnly)
+	}) {
+		std::remove(fileName.c_str());
+		File handler(Tial::Utility::Logger::Level::Nice3, fileName, policy.second);
+		fileThroughput(policy.first, handler, 1);
+	}
+	{
+		std::remove(fileName.c_str());
+		File handler(Tial::Utility::Logger::Level::Nice3, fileName, explicitOnly);
+		fileThroughput("persistent, batches of 256", handler, 256);
+	}
+	std::remove(fileName.c_str());
+});
+
+std::streamoff fileSize(const std::string &fileName) {
+	return std::ifstream(fileName, std::ios::binary | std::ios::ate).tellg();
+}
+
+Tial::Utility::Benchmark::Registration flightRecorder("Logger/FlightRecorder", [](){
+	const std::string fileName = "BenchmarkTialUtilityFlight.ring";
+	std::remove(fileName.c_str());
+	{
+		Tial::Utility::Logger::Handlers::FlightRecorder handler(Tial::Utility::Logger::Level::Nice3, fileName);
+		fileThroughput("flight recorder", handler, 1);
+	}
+	std::size_t decoded = 0;
+	auto start = Tial::Utility::Benchmark::Clock::now();
+	Tial::Utility::Logger::Handlers::FlightRecorder::decode(fileName, [&decoded](const Tial::Utility::Logger::Message&) {
+		++decoded;
+	});
+	std::cout << "decoded " << decoded << " messages in "
+		<< std::chrono::duration_cast<std::chrono::milliseconds>(Tial::Utility::Benchmark::Clock::now() - start).count()
+		<< " ms" << std::endl;
+	std::remove(fileName.c_str());
+});
+
+Tial::Utility::Benchmark::Registration deduplicate("Logger/Deduplicate", [](){
+	typedef Tial::Utility::Logger::Handlers::File File;
+	typedef Tial::Utility::Logger::Handlers::Deduplicate Deduplicate;
+	const std::string plainName = "BenchmarkTialUtilityStorm.log";
+	const std::string collapsedName = "BenchmarkTialUtilityCollapsed.log";
+	static const Tial::Utility::Logger::Site site{
+		__FILE__, __LINE__, __FUNCTION__, TIAL_UTILITY_LANGUAGE_FUNCTION_SIGNATURE, TIAL_UTILITY_LANGUAGE_CURRENT_MODULE
+	};
+	const unsigned int count = 50000;
+
+	auto storm = [&](const std::string &name, Tial::Utility::Logger::Handler &handler) {
+		Tial::Utility::Benchmark::Samples samples;
+		samples.reserve(count);
+		auto start = Tial::Utility::Benchmark::Clock::now();
+		for(unsigned int i = 0; i < count; ++i) {
+			Tial::Utility::Logger::Message pending(site, Tial::Utility::Logger::Level::Warning, std::chrono::system_clock::now());
+			Tial::Utility::Logger::Message message(std::move(pending));
+			message.out() << "connection refused, retrying";
+			auto begin = Tial::Utility::Benchmark::Clock::now();
+			handler.log(message);
+			samples.add(Tial::Utility::Benchmark::Clock::now() - begin);
+		}
+		handler.flush();
+		Tial::Utility::Benchmark::report(name, samples, Tial::Utility::Benchmark::Clock::now() - start);
+	};
+
+	{
+		std::remove(plainName.c_str());
+		File handler(Tial::Utility::Logger::Level::Nice3, plainName);
+		storm("repeated message, file", handler);
+	}
+	{
+		std::remove(collapsedName.c_str());
+		Deduplicate handler(Tial::Utility::Logger::Level::Nice3,
+			std::make_unique<File>(Tial::Utility::Logger::Level::Nice3, collapsedName));
+		storm("repeated message, deduplicated file", handler);
+	}
+	std::cout << "bytes written: file " << fileSize(plainName) << ", deduplicated " << fileSize(collapsedName) << std::endl;
+	std::remove(plainName.c_str());
+	std::remove(collapsedName.c_str());
+});
+
+Tial::Utility::Benchmark::Registration binaryHandler("Logger/BinaryHandler", [](){
+	typedef Tial::Utility::Logger::Handlers::File File;
+	typedef Tial::Utility::Logger::Handlers::Binary Binary;
+	const std::string textName = "BenchmarkTialUtilityText.log";
+	const std::string binaryName = "BenchmarkTialUtilityBinary.tlog";
+	File::FlushPolicy explicitOnly;
+	explicitOnly.interval = std::chrono::milliseconds(0);
+	explicitOnly.critical = false;
+	{
+		std::remove(textName.c_str());
+		File handler(Tial::Utility::Logger::Level::Nice3, textName, explicitOnly);
+		fileThroughput("text", handler, 1);
+	}
+	{
+		std::remove(binaryName.c_str());
+		Binary handler(Tial::Utility::Logger::Level::Nice3, binaryName);
+		fileThroughput("binary", handler, 1);
+	}
+	std::cout << "bytes written: text " << fileSize(textName) << ", binary " << fileSize(binaryName) << std::endl;
+	std::remove(textName.c_str());
+	std::remove(binaryName.c_str());
+});
+
+void producerLatency(const std::string &name, unsigned int threads, unsigned int count) {
+	std::vector<Tial::Utility::Benchmark::Samples> samples(threads);
+	std::vector<std::thread> producers;
+
+	auto start = Tial::Utility::Benchmark::Clock::now();
+	for(unsigned int t = 0; t < threads; ++t)
+		producers.emplace_back([&samples, t, count](){
+			samples[t].reserve(count);
+			for(unsigned int i = 0; i < count; ++i) {
+				auto begin = Tial::Utility::Benchmark::Clock::now();
+				LOGI << "benchmark message " << i << " from producer " << t;
+				samples[t].add(Tial::Utility::Benchmark::Clock::now() - begin);
+			}
+		});
+	for(auto &&producer: producers)
+		producer.join();
+	auto total = Tial::Utility::Benchmark::Clock::now() - start;
+
+	Tial::Utility::Benchmark::Samples all;
+	for(auto &&s: samples)
+		all.merge(s);
+	Tial::Utility::Benchmark::report(name + ", " + std::to_string(threads) + " producers", all, total);
+}
+
+Tial::Utility::Benchmark::Registration asynchronousMode("Logger/AsynchronousMode", [](){
+	installFileHandler();
+	for(unsigned int threads: {1u, 4u}) {
+		producerLatency("synchronous", threads, 20000);
+
+		Tial::Utility::Logger::enableAsynchronousMode();
+		producerLatency("asynchronous", threads, 20000);
+		Tial::Utility::Logger::disableAsynchronousMode();
+	}
+});
+
+// Logger::Stream as it was before the per-thread buffer: std::ostringstream, copied out for every handler
+class LegacyStream {
+	std::ostringstream oss;
+public:
+	template<typename T>
+	LegacyStream &operator<<(const T &value) {
+		oss << value;
+		return *this;
+	}
+
+	LegacyStream &operator<<(bool value) {
+		oss << (value ? "true" : "false");
+		return *this;
+	}
+
+	LegacyStream &operator<<(const void *pointer) {
+		std::ostringstream hexPointer;
+		hexPointer << std::hex << reinterpret_cast<uintptr_t>(pointer);
+		oss << "@0x" << hexPointer.str();
+		return *this;
+	}
+
+	std::string output() const {
+		return oss.str();
+	}
+};
+
+template<typename Function>
+void perMessage(const std::string &name, Function &&function) {
+	const unsigned int count = 2000000;
+	std::size_t total = 0;
+	auto start = Tial::Utility::Benchmark::Clock::now();
+	for(unsigned int i = 0; i < count; ++i)
+		total += function(i);
+	auto duration = Tial::Utility::Benchmark::Clock::now() - start;
+	std::cout << std::left << std::setw(48) << name << std::right << std::setw(12)
+		<< std::chrono::duration<double, std::nano>(duration).count()/count << " ns/message"
+		<< " (" << total/count << " bytes)" << std::endl;
+}
+
+Tial::Utility::Benchmark::Registration stream("Logger/Stream", [](){
+	const void *pointer = &pointer;
+	perMessage("std::ostringstream, output() copy", [pointer](unsigned int i) {
+		LegacyStream s;
+		s << "request " << i << " from " << pointer << " took " << 1234567890123ll << " completed " << true;
+		return s.output().size();
+	});
+	perMessage("thread-local buffer, view()", [pointer](unsigned int i) {
+		Tial::Utility::Logger::Stream s;
+		s << "request " << i << " from " << pointer << " took " << 1234567890123ll << " completed " << true;
+		return s.view().size();
+	});
+	perMessage("same values as typed fields", [](unsigned int i) {
+		Tial::Utility::Logger::Stream s;
+		s.kv("request", i).kv("took", 1234567890123ll).kv("completed", true) << "request";
+		return s.view().size();
+	});
+});
+
+Tial::Utility::Benchmark::Registration consoleAndFile("Logger/ConsoleAndFile", [](){
+	// run with standard error redirected; the file handler writes to /dev/null
+	Tial::Utility::Logger::Handlers::StandardOutput console(Tial::Utility::Logger::Level::Nice3);
+	Tial::Utility::Logger::Handlers::File file(Tial::Utility::Logger::Level::Nice3, "/dev/null");
+	auto messages = records(50000);
+	Tial::Utility::Benchmark::Samples samples;
+	samples.reserve(messages.size());
+
+	auto start = Tial::Utility::Benchmark::Clock::now();
+	for(auto &&message: messages) {
+		auto begin = Tial::Utility::Benchmark::Clock::now();
+		console.log(message);
+		file.log(message);
+		samples.add(Tial::Utility::Benchmark::Clock::now() - begin);
+	}
+	file.flush();
+	Tial::Utility::Benchmark::report("console and file", samples, Tial::Utility::Benchmark::Clock::now() - start);
+});
+
+Tial::Utility::Benchmark::Registration disabledStatement("Logger/DisabledStatement", [](){
+	// Info passes the compile-time level of every build type, so the statement is disabled at runtime only
+	Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Warning);
+	const unsigned int count = 10000000;
+	volatile unsigned int sink = 0;
+	auto start = Tial::Utility::Benchmark::Clock::now();
+	for(unsigned int i = 0; i < count; ++i)
+		LOGI << "disabled " << sink;
+	auto total = Tial::Utility::Benchmark::Clock::now() - start;
+	std::cout << std::left << std::setw(48) << "disabled LOGI" << std::right << std::setw(12)
+		<< std::chrono::duration<double, std::nano>(total).count()/count << " ns/statement" << std::endl;
+	Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Info);
+});
+
+class Discard: public Tial::Utility::Logger::Handler {
+public:
+	using Handler::Handler;
+	virtual void write(const Tial::Utility::Logger::Message&) override {}
+};
+
+Tial::Utility::Benchmark::Registration unacceptedLevel("Logger/UnacceptedLevel", [](){
+	// run alone: any other registered handler accepting Info would make the statements pass
+	auto handler = std::make_unique<Discard>(Tial::Utility::Logger::Level::Warning);
+	Tial::Utility::Logger::Handler *registered = handler.get();
+	Tial::Utility::Logger::addHandler(std::move(handler));
+	Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Info);
+
+	const unsigned int count = 1000000;
+	const void *pointer = &pointer;
+	auto start = Tial::Utility::Benchmark::Clock::now();
+	for(unsigned int i = 0; i < count; ++i)
+		LOGI << "request " << i << " from " << pointer << " took " << 1234567890123ll;
+	auto total = Tial::Utility::Benchmark::Clock::now() - start;
+	std::cout << std::left << std::setw(48) << "LOGI, only handler at Warning" << std::right << std::setw(12)
+		<< std::chrono::duration<double, std::nano>(total).count()/count << " ns/statement" << std::endl;
+	Tial::Utility::Logger::removeHandler(registered);
+});
+
+void fanOut(const std::string &name, const std::vector<std::vector<std::string>> &modules,
+		const std::vector<Tial::Utility::Logger::Level> &levels) {
+	std::vector<Tial::Utility::Logger::Handler*> registered;
+	for(std::size_t i = 0; i < modules.size(); ++i) {
+		auto handler = std::make_unique<Discard>(levels[i]);
+		registered.push_back(handler.get());
+		Tial::Utility::Logger::addHandler(std::move(handler), modules[i]);
+	}
+	Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Info);
+
+	const unsigned int count = 1000000;
+	auto start = Tial::Utility::Benchmark::Clock::now();
+	for(unsigned int i = 0; i < count; ++i)
+		LOGI << "request " << i;
+	auto total = Tial::Utility::Benchmark::Clock::now() - start;
+	std::cout << std::left << std::setw(48) << name << std::right << std::setw(12)
+		<< std::chrono::duration<double, std::nano>(total).count()/count << " ns/statement" << std::endl;
+	for(auto &&handler: registered)
+		Tial::Utility::Logger::removeHandler(handler);
+}
+
+Tial::Utility::Benchmark::Registration routing("Logger/Routing", [](){
+	// run alone: 32 handlers, only one of which writes messages of this module
+	const std::size_t count = 32;
+	std::vector<std::vector<std::string>> everything(count), subscribed;
+	std::vector<Tial::Utility::Logger::Level> levels(count, Tial::Utility::Logger::Level::Warning);
+	levels[0] = Tial::Utility::Logger::Level::Info;
+	fanOut("every handler, rejected by level", everything, levels);
+
+	subscribed.push_back({});
+	for(std::size_t i = 1; i < count; ++i)
+		subscribed.push_back({"Benchmark::Module" + std::to_string(i)});
+	fanOut("one handler for all, others subscribed", subscribed,
+		std::vector<Tial::Utility::Logger::Level>(count, Tial::Utility::Logger::Level::Info));
+});
+
+Tial::Utility::Benchmark::Registration suppressedStatement("Logger/SuppressedStatement", [](){
+	Tial::Utility::Logger::setSuppressionReportInterval(std::chrono::steady_clock::duration::zero());
+	const unsigned int count = 10000000;
+	volatile unsigned int sink = 0;
+	auto start = Tial::Utility::Benchmark::Clock::now();
+	for(unsigned int i = 0; i < count; ++i)
+		LOGI_FIRST_N(0) << "suppressed " << sink;
+	auto total = Tial::Utility::Benchmark::Clock::now() - start;
+	std::cout << std::left << std::setw(48) << "suppressed LOGI_FIRST_N" << std::right << std::setw(12)
+		<< std::chrono::duration<double, std::nano>(total).count()/count << " ns/statement" << std::endl;
+
+	start = Tial::Utility::Benchmark::Clock::now();
+	for(unsigned int i = 0; i < count; ++i)
+		LOGI_RATE(0) << "suppressed " << sink;
+	total = Tial::Utility::Benchmark::Clock::now() - start;
+	std::cout << std::left << std::setw(48) << "suppressed LOGI_RATE" << std::right << std::setw(12)
+		<< std::chrono::duration<double, std::nano>(total).count()/count << " ns/statement" << std::endl;
+	Tial::Utility::Logger::reportSuppressed();
+	Tial::Utility::Logger::setSuppressionReportInterval(std::chrono::seconds(10));
+});
+
+}
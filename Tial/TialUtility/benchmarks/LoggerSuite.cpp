@@ -0,0 +1,176 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "Benchmark.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#define TIAL_MODULE "Tial::Utility::Logger/Benchmark"
+
+// counts allocations made by the current thread, for the whole benchmark executable
+static thread_local std::size_t allocations = 0;
+
+void *operator new(std::size_t size) {
+	++allocations;
+	if(void *pointer = std::malloc(size ? size : 1))
+		return pointer;
+	throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+	std::free(pointer);
+}
+
+namespace {
+
+typedef Tial::Utility::Logger::Level Level;
+typedef std::function<std::unique_ptr<Tial::Utility::Logger::Handler>(Level)> HandlerFactory;
+
+// tmpfs keeps the disk out of the measurement
+std::string temporary(const std::string &name) {
+	return (access("/dev/shm", W_OK) == 0 ? "/dev/shm/" : "") + name;
+}
+
+// standard error goes to /dev/null for the lifetime of the object
+class Silence {
+	int saved;
+public:
+	Silence(): saved(dup(STDERR_FILENO)) {
+		int null = open("/dev/null", O_WRONLY);
+		dup2(null, STDERR_FILENO);
+		close(null);
+	}
+
+	~Silence() {
+		dup2(saved, STDERR_FILENO);
+		close(saved);
+	}
+};
+
+void run(const std::string &handlerName, const HandlerFactory &factory, unsigned int threads,
+		std::size_t payloadSize, bool enabled) {
+	// a disabled statement is rejected by the level the only handler accepts, so nothing reaches it
+	auto handler = factory(enabled ? Level::Info : Level::Warning);
+	Tial::Utility::Logger::Handler *registered = handler.get();
+	Tial::Utility::Logger::addHandler(std::move(handler));
+
+	const unsigned int count = (enabled ? 100000 : 1000000)/threads;
+	const std::string payload(payloadSize, 'x');
+	std::vector<Tial::Utility::Benchmark::Samples> samples(threads);
+	std::vector<std::size_t> allocated(threads);
+	std::vector<std::thread> producers;
+
+	auto start = Tial::Utility::Benchmark::Clock::now();
+	for(unsigned int t = 0; t < threads; ++t)
+		producers.emplace_back([&samples, &allocated, &payload, t, count](){
+			samples[t].reserve(count);
+			std::size_t before = allocations;
+			for(unsigned int i = 0; i < count; ++i) {
+				auto begin = Tial::Utility::Benchmark::Clock::now();
+				LOGI << "message " << i << " from producer " << t << ": " << payload;
+				samples[t].add(Tial::Utility::Benchmark::Clock::now() - begin);
+			}
+			allocated[t] = allocations - before;
+		});
+	for(auto &&producer: producers)
+		producer.join();
+	Tial::Utility::Logger::flush();
+	auto total = Tial::Utility::Benchmark::Clock::now() - start;
+	Tial::Utility::Logger::removeHandler(registered);
+
+	Tial::Utility::Benchmark::Samples all;
+	std::size_t allocatedTotal = 0;
+	for(unsigned int t = 0; t < threads; ++t) {
+		all.merge(samples[t]);
+		allocatedTotal += allocated[t];
+	}
+	Tial::Utility::Benchmark::report(
+		handlerName + ", " + std::to_string(threads) + " producers, " + std::to_string(payloadSize) + " B, "
+			+ (enabled ? "enabled" : "disabled"),
+		all, total, static_cast<double>(allocatedTotal)/all.size()
+	);
+}
+
+void suite(const std::string &handlerName, const HandlerFactory &factory) {
+	std::vector<unsigned int> producers{1, 2, 4};
+	if(std::thread::hardware_concurrency() > 4)
+		producers.push_back(std::thread::hardware_concurrency());
+	for(bool enabled: {true, false})
+		for(std::size_t payloadSize: {16u, 256u, 4096u})
+			for(unsigned int threads: producers)
+				run(handlerName, factory, threads, payloadSize, enabled);
+}
+
+Tial::Utility::Benchmark::Registration standardOutput("LoggerSuite/StandardOutput", [](){
+	Silence silence;
+	suite("StandardOutput", [](Level level) {
+		return std::make_unique<Tial::Utility::Logger::Handlers::StandardOutput>(level);
+	});
+});
+
+Tial::Utility::Benchmark::Registration file("LoggerSuite/File", [](){
+	const std::string fileName = temporary("BenchmarkTialLogger.log");
+	suite("File", [&fileName](Level level) {
+		std::remove(fileName.c_str());
+		return std::make_unique<Tial::Utility::Logger::Handlers::File>(level, fileName);
+	});
+	std::remove(fileName.c_str());
+});
+
+Tial::Utility::Benchmark::Registration jsonLines("LoggerSuite/JsonLines", [](){
+	const std::string fileName = temporary("BenchmarkTialLogger.jsonl");
+	suite("JsonLines", [&fileName](Level level) {
+		std::remove(fileName.c_str());
+		return std::make_unique<Tial::Utility::Logger::Handlers::JsonLines>(level, fileName);
+	});
+	std::remove(fileName.c_str());
+});
+
+Tial::Utility::Benchmark::Registration binary("LoggerSuite/Binary", [](){
+	const std::string fileName = temporary("BenchmarkTialLogger.tlog");
+	suite("Binary", [&fileName](Level level) {
+		std::remove(fileName.c_str());
+		return std::make_unique<Tial::Utility::Logger::Handlers::Binary>(level, fileName);
+	});
+	std::remove(fileName.c_str());
+});
+
+Tial::Utility::Benchmark::Registration flightRecorder("LoggerSuite/FlightRecorder", [](){
+	const std::string fileName = temporary("BenchmarkTialLogger.ring");
+	suite("FlightRecorder", [&fileName](Level level) {
+		std::remove(fileName.c_str());
+		return std::make_unique<Tial::Utility::Logger::Handlers::FlightRecorder>(level, fileName);
+	});
+	std::remove(fileName.c_str());
+});
+
+}
@@ -0,0 +1,43 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "Benchmark.hpp"
+
+std::vector<std::pair<std::string, Tial::Utility::Benchmark::Function>> &Tial::Utility::Benchmark::benchmarks() {
+	static std::vector<std::pair<std::string, Function>> benchmarks;
+	return benchmarks;
+}
+
+Tial::Utility::Benchmark::Registration::Registration(const std::string &name, const Function &function) {
+	benchmarks().emplace_back(name, function);
+}
+
+int main(int argc, char **argv) {
+	std::string filter = argc > 1 ? argv[1] : "";
+	for(auto &&benchmark: Tial::Utility::Benchmark::benchmarks()) {
+		if(benchmark.first.find(filter) == std::string::npos)
+			continue;
+		std::cout << "== " << benchmark.first << std::endl;
+		benchmark.second();
+	}
+	return 0;
+}
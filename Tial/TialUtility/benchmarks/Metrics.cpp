@@ -0,0 +1,72 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "Benchmark.hpp"
+
+#define TIAL_MODULE "Tial::Utility::Metrics/Benchmark"
+
+namespace {
+
+template<typename Function>
+void perUpdate(const std::string &name, unsigned int threads, Function &&function) {
+	const unsigned int count = 10000000/threads;
+	std::vector<std::thread> workers;
+	auto start = Tial::Utility::Benchmark::Clock::now();
+	for(unsigned int t = 0; t < threads; ++t)
+		workers.emplace_back([&function, count](){
+			for(unsigned int i = 0; i < count; ++i)
+				function(i);
+		});
+	for(auto &&worker: workers)
+		worker.join();
+	auto total = Tial::Utility::Benchmark::Clock::now() - start;
+	std::cout << std::left << std::setw(48) << name + ", " + std::to_string(threads) + " threads" << std::right
+		<< std::setw(12) << std::chrono::duration<double, std::nano>(total).count()/(count*threads)
+		<< " ns/update" << std::endl;
+}
+
+Tial::Utility::Benchmark::Registration updates("Metrics/Updates", [](){
+	Tial::Utility::Metrics::Counter counter(TIAL_MODULE, "counter");
+	Tial::Utility::Metrics::Gauge gauge(TIAL_MODULE, "gauge");
+	Tial::Utility::Metrics::Histogram histogram(TIAL_MODULE, "histogram");
+	// a single shared atomic, as a reference for the sharded counter
+	std::atomic<uint64_t> shared{0};
+	std::vector<unsigned int> threadCounts{1};
+	if(std::thread::hardware_concurrency() > 1)
+		threadCounts.push_back(std::thread::hardware_concurrency());
+	for(unsigned int threads: threadCounts) {
+		perUpdate("shared atomic", threads, [&shared](unsigned int) {
+			shared.fetch_add(1, std::memory_order_relaxed);
+		});
+		perUpdate("Counter::add", threads, [&counter](unsigned int) {
+			counter.add();
+		});
+		perUpdate("Gauge::set", threads, [&gauge](unsigned int i) {
+			gauge.set(i);
+		});
+		perUpdate("Histogram::record", threads, [&histogram](unsigned int i) {
+			histogram.record(i);
+		});
+	}
+});
+
+}
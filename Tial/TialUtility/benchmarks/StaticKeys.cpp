@@ -0,0 +1,90 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+// constant-level statements of this file are emitted with static keys
+#ifndef TIAL_UTILITY_LOGGER_STATIC_KEYS
+#define TIAL_UTILITY_LOGGER_STATIC_KEYS
+#endif
+
+#include "Benchmark.hpp"
+
+#define TIAL_MODULE "Tial::Utility::Logger/StaticKeysBenchmark"
+
+namespace {
+
+template<typename Function>
+void innerLoop(const std::string &name, Function &&function) {
+	const unsigned int count = 100000000;
+	auto start = Tial::Utility::Benchmark::Clock::now();
+	unsigned int sum = function(count);
+	auto total = Tial::Utility::Benchmark::Clock::now() - start;
+	std::cout << std::left << std::setw(48) << name << std::right << std::setw(12)
+		<< std::chrono::duration<double, std::nano>(total).count()/count << " ns/iteration"
+		<< " (" << sum << ")" << std::endl;
+}
+
+Tial::Utility::Benchmark::Registration staticKeys("Logger/StaticKeys", [](){
+	Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Warning, TIAL_MODULE);
+	std::cout << "dormant sites: " << Tial::Utility::Logger::dormantSites() << std::endl;
+
+	innerLoop("empty loop", [](unsigned int count) {
+		unsigned int sum = 0;
+		for(unsigned int i = 0; i < count; ++i) {
+			__asm__ volatile("" : "+r"(sum));
+			sum += i;
+		}
+		return sum;
+	});
+	// as if the module's compile level were above Info
+	innerLoop("compiled out", [](unsigned int count) {
+		unsigned int sum = 0;
+		for(unsigned int i = 0; i < count; ++i) {
+			__asm__ volatile("" : "+r"(sum));
+			sum += i;
+			TIAL_UTILITY_LOGGER_LOG_INTERNAL(__FILE__, __LINE__, __FUNCTION__, TIAL_UTILITY_LANGUAGE_FUNCTION_SIGNATURE,
+				Tial::Utility::Logger::Level::Info, TIAL_UTILITY_LANGUAGE_CURRENT_MODULE, 100) << "sum " << sum;
+		}
+		return sum;
+	});
+	innerLoop("dormant static key", [](unsigned int count) {
+		unsigned int sum = 0;
+		for(unsigned int i = 0; i < count; ++i) {
+			__asm__ volatile("" : "+r"(sum));
+			sum += i;
+			LOGI << "sum " << sum;
+		}
+		return sum;
+	});
+	innerLoop("branch-guarded", [](unsigned int count) {
+		unsigned int sum = 0;
+		for(unsigned int i = 0; i < count; ++i) {
+			__asm__ volatile("" : "+r"(sum));
+			sum += i;
+			TIAL_UTILITY_LOGGER_LOG(Tial::Utility::Logger::Level::Info) << "sum " << sum;
+		}
+		return sum;
+	});
+
+	Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Info, TIAL_MODULE);
+});
+
+}
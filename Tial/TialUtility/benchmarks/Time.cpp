@@ -0,0 +1,57 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "Benchmark.hpp"
+
+#define TIAL_MODULE "Tial::Utility::Time/Benchmark"
+
+namespace {
+
+template<typename Function>
+void perTimestamp(const std::string &name, Function &&function) {
+	const unsigned int count = 1000000;
+	auto time = std::chrono::system_clock::now();
+	std::size_t total = 0;
+	auto start = Tial::Utility::Benchmark::Clock::now();
+	// consecutive timestamps 1 us apart, as in a busy log
+	for(unsigned int i = 0; i < count; ++i)
+		total += function(time + std::chrono::microseconds(i));
+	auto duration = Tial::Utility::Benchmark::Clock::now() - start;
+	std::cout << std::left << std::setw(48) << name << std::right << std::setw(12)
+		<< std::chrono::duration<double, std::nano>(duration).count()/count << " ns/timestamp"
+		<< " (" << total/count << " bytes)" << std::endl;
+}
+
+Tial::Utility::Benchmark::Registration timestamp("Time/Timestamp", [](){
+	for(auto zone: {Tial::Utility::Time::Zone::Local, Tial::Utility::Time::Zone::UTC}) {
+		std::string suffix = zone == Tial::Utility::Time::Zone::Local ? ", local" : ", UTC";
+		perTimestamp("timeCast" + suffix, [zone](const std::chrono::system_clock::time_point &time) {
+			return Tial::Utility::Time::timeCast(time, zone).size();
+		});
+		perTimestamp("formatTimestamp" + suffix, [zone](const std::chrono::system_clock::time_point &time) {
+			char output[Tial::Utility::Time::maxTimestampLength];
+			return Tial::Utility::Time::formatTimestamp(time, output, zone);
+		});
+	}
+});
+
+}
@@ -0,0 +1,61 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "Benchmark.hpp"
+
+#define TIAL_MODULE "Tial::Utility::Trace/Benchmark"
+
+namespace {
+
+template<bool enabled>
+unsigned int spans(unsigned int count) {
+	unsigned int sum = 0;
+	for(unsigned int i = 0; i < count; ++i) {
+		Tial::Utility::Trace::Scope<enabled> scope("span");
+		__asm__ volatile("" : "+r"(sum));
+		sum += i;
+	}
+	return sum;
+}
+
+template<typename Function>
+void perSpan(const std::string &name, Function &&function) {
+	const unsigned int count = 1000000;
+	auto start = Tial::Utility::Benchmark::Clock::now();
+	unsigned int sum = function(count);
+	auto total = Tial::Utility::Benchmark::Clock::now() - start;
+	std::cout << std::left << std::setw(48) << name << std::right << std::setw(12)
+		<< std::chrono::duration<double, std::nano>(total).count()/count << " ns/span"
+		<< " (" << sum << ")" << std::endl;
+	// keeps the buffers from growing across runs
+	Tial::Utility::Trace::collect([](const std::string&, unsigned int, const Tial::Utility::Trace::Event&){});
+}
+
+Tial::Utility::Benchmark::Registration scope("Trace/Scope", [](){
+	perSpan("compiled out", spans<false>);
+	perSpan("not recording", spans<true>);
+	Tial::Utility::Trace::start();
+	perSpan("recording", spans<true>);
+	Tial::Utility::Trace::stop();
+});
+
+}
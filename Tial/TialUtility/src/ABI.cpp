@@ -23,6 +23,7 @@
 #include "ABI.hpp"
 #include "Logger.hpp"
 
+#include <algorithm>
 #include <functional>
 #include <memory>
 
@@ -110,3 +111,14 @@ std::type_index Tial::Utility::ABI::currentExceptionType() {
 #error "Platform not supported"
 #endif
 }
+
+void Tial::Utility::ABI::writeStackTrace(int descriptor, unsigned int skipLevels) {
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	void *buffer[256];
+	int count = backtrace(buffer, sizeof(buffer)/sizeof(buffer[0]));
+	int skip = std::min(static_cast<int>(skipLevels), count);
+	backtrace_symbols_fd(buffer + skip, count - skip, descriptor);
+#else
+#error "Platform not supported"
+#endif
+}
@@ -21,6 +21,7 @@
  * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #include "Directory.hpp"
+#include "Metrics.hpp"
 
 #include <algorithm>
 #include <memory>
@@ -34,6 +35,11 @@
 
 #include <boost/predef.h>
 
+#define TIAL_MODULE "Tial::Utility::Directory"
+
+static Tial::Utility::Metrics::Counter contentEntries(TIAL_MODULE, "content.entries");
+static Tial::Utility::Metrics::Histogram contentLatency(TIAL_MODULE, "content.latency_ns");
+
 Tial::Utility::NativePath Tial::Utility:: _currentPath() {
 #if (BOOST_OS_UNIX || BOOST_OS_MACOS)
 	std::unique_ptr<char, std::function<void(char*)>> rawPath(
@@ -55,6 +61,7 @@ std::vector<std::shared_ptr<Tial::Utility::_DirectoryEntry<
 	Tial::Utility::NativePath
 >>> Tial::Utility::_directoryContent(const NativePath &path) {
 #if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	Metrics::Histogram::Timer timer(contentLatency);
 	std::vector<std::shared_ptr<_DirectoryEntry<NativePath>>> output;
 
 	std::unique_ptr<DIR, std::function<void(DIR*)>> directory(
@@ -83,6 +90,7 @@ std::vector<std::shared_ptr<Tial::Utility::_DirectoryEntry<
 	}
 
 	std::sort(output.begin(), output.end());
+	contentEntries.add(output.size());
 
 	return output;
 #else
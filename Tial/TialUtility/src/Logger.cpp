@@ -22,22 +22,57 @@
  */
 #include "Logger.hpp"
 #include "ABI.hpp"
+#include "ConcurrentQueue.hpp"
+#include "Rcu.hpp"
 #include "Thread.hpp"
 #include "Time.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
 #include <codecvt>
-#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <iostream>
+#include <limits>
 #include <locale>
+#include <map>
 #include <mutex>
+#include <new>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
 #include <boost/algorithm/string.hpp>
 
-using namespace std::literals;
+#include <zlib.h>
+
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+#include <dirent.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#if (defined __linux__)
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#endif
+#else
+#error "Platform not supported"
+#endif
 
-static Tial::Utility::Logger::Level globalLevel = Tial::Utility::Logger::Level::Nice3;
+#define TIAL_MODULE "Tial::Utility::Logger"
+
+using namespace std::literals;
 
 std::ostream&
 Tial::Utility::Logger::operator<<(std::ostream &os, Level level) {
@@ -54,61 +89,160 @@ Tial::Utility::Logger::operator<<(std::ostream &os, Level level) {
 	return os;
 }
 
+namespace {
+
+struct LocalBuffer {
+	static constexpr std::size_t capacity = 1024;
+	char data[capacity];
+	bool used;
+};
+
+thread_local LocalBuffer localBuffer;
+
+template<typename Output, typename T>
+void appendUnsigned(Output &s, T value) {
+	char digits[24];
+	char *end = digits + sizeof(digits);
+	char *begin = end;
+	do {
+		*--begin = static_cast<char>('0' + value % 10);
+		value /= 10;
+	} while(value);
+	s.append(begin, end - begin);
+}
+
+template<typename Output, typename T>
+void appendSigned(Output &s, T value) {
+	typedef typename std::make_unsigned<T>::type Unsigned;
+	if(value < 0) {
+		s.append("-", 1);
+		appendUnsigned(s, static_cast<Unsigned>(0 - static_cast<Unsigned>(value)));
+	} else {
+		appendUnsigned(s, static_cast<Unsigned>(value));
+	}
+}
+
+}
+
+Tial::Utility::Logger::Stream::Stream(Stream &&other) {
+	if(other.local) {
+		if(other.size > 0) {
+			reserve(other.size);
+			std::memcpy(data, other.data, other.size);
+			size = other.size;
+		}
+		other.release();
+	} else {
+		std::swap(data, other.data);
+		std::swap(size, other.size);
+		std::swap(capacity, other.capacity);
+	}
+	fields = std::move(other.fields);
+}
+
+Tial::Utility::Logger::Stream::~Stream() {
+	release();
+}
+
+void Tial::Utility::Logger::Stream::release() {
+	if(local)
+		localBuffer.used = false;
+	else
+		delete[] data;
+	data = nullptr;
+	size = capacity = 0;
+	local = false;
+}
+
+void Tial::Utility::Logger::Stream::reserve(std::size_t required) {
+	if(required <= capacity)
+		return;
+	if(capacity == 0 && required <= LocalBuffer::capacity && !localBuffer.used) {
+		localBuffer.used = true;
+		local = true;
+		data = localBuffer.data;
+		capacity = LocalBuffer::capacity;
+		return;
+	}
+
+	std::size_t newCapacity = std::max(required, std::max<std::size_t>(2*capacity, 64));
+	char *newData = new char[newCapacity];
+	if(size > 0)
+		std::memcpy(newData, data, size);
+	std::size_t newSize = size;
+	release();
+	data = newData;
+	size = newSize;
+	capacity = newCapacity;
+}
+
+void Tial::Utility::Logger::Stream::append(const char *text, std::size_t length) {
+	reserve(size + length);
+	if(length > 0)
+		std::memcpy(data + size, text, length);
+	size += length;
+}
+
 Tial::Utility::Logger::Stream::operator bool() const {
 	return true;
 }
 
 std::string Tial::Utility::Logger::Stream::output() const {
-	return oss.str();
+	return std::string(data ? data : "", size);
+}
+
+std::experimental::string_view Tial::Utility::Logger::Stream::view() const {
+	return std::experimental::string_view(data, size);
 }
 
 Tial::Utility::Logger::Stream&
 Tial::Utility::Logger::operator<<(Stream &s, const char *string) {
-	s.oss << string;
+	s.append(string, std::strlen(string));
 	return s;
 }
 
 Tial::Utility::Logger::Stream&
 Tial::Utility::Logger::operator<<(Stream &s, int value) {
-	s.oss << value;
+	appendSigned(s, value);
 	return s;
 }
 
 Tial::Utility::Logger::Stream&
 Tial::Utility::Logger::operator<<(Stream &s, unsigned int value) {
-	s.oss << value;
+	appendUnsigned(s, value);
 	return s;
 }
 
 Tial::Utility::Logger::Stream&
 Tial::Utility::Logger::operator<<(Stream &s, long value) {
-	s.oss << value;
+	appendSigned(s, value);
 	return s;
 }
 
 Tial::Utility::Logger::Stream&
 Tial::Utility::Logger::operator<<(Stream &s, unsigned long value) {
-	s.oss << value;
+	appendUnsigned(s, value);
 	return s;
 }
 
-
 Tial::Utility::Logger::Stream&
 Tial::Utility::Logger::operator<<(Stream &s, long long value) {
-	s.oss << value;
+	appendSigned(s, value);
 	return s;
 }
 
-
 Tial::Utility::Logger::Stream&
 Tial::Utility::Logger::operator<<(Stream &s, unsigned long long value) {
-	s.oss << value;
+	appendUnsigned(s, value);
 	return s;
 }
 
 Tial::Utility::Logger::Stream&
 Tial::Utility::Logger::operator<<(Stream &s, const std::string &string) {
-	return s << "\"" << string.c_str() << "\"";
+	s.append("\"", 1);
+	s.append(string.data(), string.size());
+	s.append("\"", 1);
+	return s;
 }
 
 Tial::Utility::Logger::Stream&
@@ -125,14 +259,28 @@ Tial::Utility::Logger::operator<<(Stream &s, const std::u32string &string) {
 
 Tial::Utility::Logger::Stream&
 Tial::Utility::Logger::operator<<(Stream &s, const void *ptr) {
-	std::ostringstream hexPtr;
-	hexPtr << std::hex << reinterpret_cast<uintptr_t>(ptr);
-	return s << "@0x" << hexPtr.str().c_str();
+	char digits[2*sizeof(uintptr_t) + 3];
+	char *end = digits + sizeof(digits);
+	char *begin = end;
+	uintptr_t value = reinterpret_cast<uintptr_t>(ptr);
+	do {
+		*--begin = "0123456789abcdef"[value & 0xf];
+		value >>= 4;
+	} while(value);
+	*--begin = 'x';
+	*--begin = '0';
+	*--begin = '@';
+	s.append(begin, end - begin);
+	return s;
 }
 
 Tial::Utility::Logger::Stream&
 Tial::Utility::Logger::operator<<(Stream &s, bool value) {
-	return s << (value ? "true" : "false");
+	if(value)
+		s.append("true", 4);
+	else
+		s.append("false", 5);
+	return s;
 }
 
 Tial::Utility::Logger::Stream&
@@ -163,7 +311,10 @@ Tial::Utility::Logger::operator<<(Stream &s, const std::exception &exception) {
 
 Tial::Utility::Logger::Stream &
 Tial::Utility::Logger::operator<<(Stream &s, const std::experimental::string_view &string_view) {
-	return s << string_view.to_string();
+	s.append("\"", 1);
+	s.append(string_view.data(), string_view.size());
+	s.append("\"", 1);
+	return s;
 }
 
 namespace Tial {
@@ -179,97 +330,1018 @@ template<> TIALUTILITY_EXPORT std::experimental::string_view timePeriod<std::chr
 }
 }
 
-Tial::Utility::Logger::Message::Message(
-	const std::experimental::string_view &file, unsigned int line, const std::experimental::string_view &function,
-	const std::experimental::string_view &prettyFunction, Level level, const std::experimental::string_view &module,
-	const TimePoint &time
-): file(file.to_string()), line(line), function(function.to_string()), prettyFunction(prettyFunction.to_string()),
-	level(level), module(module.to_string()), time(time) {}
+Tial::Utility::Logger::Message::Message(const Site &site, Level level, const TimePoint &time)
+	: site(&site), level(level), time(time), thread(Thread::name()) {}
+
+Tial::Utility::Logger::Message::Message(Message &&other): pending(false), stream(std::move(other.stream)),
+	site(other.site), level(other.level), time(other.time), thread(std::move(other.thread)),
+	formattedTimeLength(other.formattedTimeLength) {
+	std::memcpy(formattedTime, other.formattedTime, formattedTimeLength);
+	other.pending = false;
+}
+
+Tial::Utility::Logger::Fields &Tial::Utility::Logger::Fields::operator=(Fields &&other) {
+	if(other.data == other.local) {
+		heap.reset();
+		data = local;
+		capacity = sizeof(local);
+		std::memcpy(local, other.local, other.size);
+	} else {
+		heap = std::move(other.heap);
+		data = heap.get();
+		capacity = other.capacity;
+	}
+	size = other.size;
+	other.data = other.local;
+	other.size = 0;
+	other.capacity = sizeof(other.local);
+	return *this;
+}
+
+void Tial::Utility::Logger::Fields::append(const void *bytes, std::size_t length) {
+	if(size + length > capacity) {
+		std::size_t grown = std::max(capacity*2, size + length);
+		std::unique_ptr<char[]> larger(new char[grown]);
+		std::memcpy(larger.get(), data, size);
+		heap = std::move(larger);
+		data = heap.get();
+		capacity = grown;
+	}
+	std::memcpy(data + size, bytes, length);
+	size += length;
+}
+
+void Tial::Utility::Logger::Fields::key(Type type, const std::experimental::string_view &key) {
+	uint16_t length = std::min<std::size_t>(key.size(), std::numeric_limits<uint16_t>::max());
+	append(&type, sizeof(type));
+	append(&length, sizeof(length));
+	append(key.data(), length);
+}
+
+void Tial::Utility::Logger::Fields::add(const std::experimental::string_view &key, int64_t value) {
+	this->key(Type::Signed, key);
+	append(&value, sizeof(value));
+}
+
+void Tial::Utility::Logger::Fields::add(const std::experimental::string_view &key, uint64_t value) {
+	this->key(Type::Unsigned, key);
+	append(&value, sizeof(value));
+}
+
+void Tial::Utility::Logger::Fields::add(const std::experimental::string_view &key, double value) {
+	this->key(Type::Floating, key);
+	append(&value, sizeof(value));
+}
+
+void Tial::Utility::Logger::Fields::add(const std::experimental::string_view &key, bool value) {
+	this->key(Type::Boolean, key);
+	uint64_t stored = value;
+	append(&stored, sizeof(stored));
+}
+
+void Tial::Utility::Logger::Fields::add(const std::experimental::string_view &key,
+		const std::experimental::string_view &value) {
+	this->key(Type::String, key);
+	uint32_t length = std::min<std::size_t>(value.size(), std::numeric_limits<uint32_t>::max());
+	append(&length, sizeof(length));
+	append(value.data(), length);
+}
+
+// shortest of %.15g and %.17g that reads back as the same value
+static void appendFloating(std::string &output, double value) {
+	char text[32];
+	int length = std::snprintf(text, sizeof(text), "%.15g", value);
+	if(std::strtod(text, nullptr) != value)
+		length = std::snprintf(text, sizeof(text), "%.17g", value);
+	output.append(text, length);
+}
+
+// non-string field value, formatted the same for text layouts and JSON
+static void appendValue(std::string &output, const Tial::Utility::Logger::Fields::Field &field) {
+	switch(field.type) {
+	case Tial::Utility::Logger::Fields::Type::Signed: appendSigned(output, field.signedValue); break;
+	case Tial::Utility::Logger::Fields::Type::Unsigned: appendUnsigned(output, field.unsignedValue); break;
+	case Tial::Utility::Logger::Fields::Type::Floating: appendFloating(output, field.floatingValue); break;
+	case Tial::Utility::Logger::Fields::Type::Boolean: output += field.booleanValue ? "true" : "false"; break;
+	case Tial::Utility::Logger::Fields::Type::String: break;
+	}
+}
 
-static std::string dots = "[...]";
+static const std::experimental::string_view dots = "[...]";
 
-static std::string limitString(const std::string &s, size_t maxSize = 32) {
+static void appendAbbreviated(std::string &output, const std::experimental::string_view &s, size_t maxSize = 32) {
 	if(s.length() > maxSize) {
 		size_t halfSize = (maxSize+dots.size())/2;
-		return s.substr(0, halfSize)+dots+s.substr(s.size()-halfSize);
+		output.append(s.data(), halfSize);
+		output.append(dots.data(), dots.size());
+		output.append(s.data() + s.size() - halfSize, halfSize);
+		return;
 	}
-	return s;
+	output.append(s.data(), s.size());
 }
 
-static std::string limitFileName(const std::string &name) {
+static void appendFileName(std::string &output, const std::experimental::string_view &name) {
 #ifdef TIAL_SOURCE_BASE_DIRECTORY
-	static const std::string base(TIAL_SOURCE_BASE_DIRECTORY);
-	if(boost::algorithm::starts_with(name, base)) {
-		std::string r = name.substr(base.length());
+	static const std::experimental::string_view base(TIAL_SOURCE_BASE_DIRECTORY);
+	if(name.substr(0, base.size()) == base) {
+		std::experimental::string_view r = name.substr(base.length());
 		if(!r.empty()) {
 			if(r[0] == '/' || r[0] == '\\')
 				r = r.substr(1);
-			if(!r.empty())
-				return r;
+			if(!r.empty()) {
+				output.append(r.data(), r.size());
+				return;
+			}
 		}
 	}
 #endif
-	return limitString(name);
+	appendAbbreviated(output, name);
+}
+
+static void appendEscaped(std::string &output, std::experimental::string_view s) {
+	for(;;) {
+		auto special = s.find_first_of("\\\t\n");
+		output.append(s.data(), std::min(special, s.size()));
+		if(special == s.npos)
+			return;
+		switch(s[special]) {
+		case '\t': output += "\\t"; break;
+		case '\n': output += "\\n"; break;
+		default: output += "\\\\"; break;
+		}
+		s = s.substr(special + 1);
+	}
+}
+
+namespace {
+
+// Handlers receiving messages of a module: those subscribed to all modules and those subscribed to this
+// node's prefix or a shorter one. Routes form a trie of "::"-separated name components, like module levels.
+struct Route {
+	std::map<std::string, std::size_t, std::less<>> children;
+	// indices into Routing::handlers, in registration order
+	std::vector<std::size_t> handlers;
+	// lowest level any of them accepts
+	uint8_t level = std::numeric_limits<uint8_t>::max();
+};
+
+// Immutable snapshot of the registered handlers, rebuilt whenever one is added, removed or changes level
+struct Routing {
+	uint64_t generation = 0;
+	std::vector<Tial::Utility::Logger::Handler*> handlers;
+	std::vector<Route> routes = std::vector<Route>(1);
+
+	// route of the longest subscribed prefix of module; the root when there is none
+	std::size_t find(std::experimental::string_view module) const {
+		std::size_t index = 0;
+		while(!module.empty()) {
+			auto sep = module.find("::");
+			auto child = routes[index].children.find(module.substr(0, sep));
+			if(child == routes[index].children.end())
+				break;
+			index = child->second;
+			module = sep == module.npos ? std::experimental::string_view() : module.substr(sep+2);
+		}
+		return index;
+	}
+
+	// found once per site and routing generation, then read from the site
+	const Route &route(const Tial::Utility::Logger::Site &site) const {
+		uint64_t cached = site.route.load(std::memory_order_relaxed);
+		if((cached >> 16) == generation)
+			return routes[cached & 0xffff];
+		std::size_t index = find(site.module);
+		if(index <= 0xffff)
+			site.route.store((generation << 16) | index, std::memory_order_relaxed);
+		return routes[index];
+	}
+
+	std::size_t insert(std::experimental::string_view module) {
+		std::size_t index = 0;
+		while(!module.empty()) {
+			auto sep = module.find("::");
+			auto name = module.substr(0, sep);
+			auto child = routes[index].children.find(name);
+			if(child == routes[index].children.end()) {
+				routes[index].children.emplace(name.to_string(), routes.size());
+				index = routes.size();
+				routes.emplace_back();
+			} else {
+				index = child->second;
+			}
+			module = sep == module.npos ? std::experimental::string_view() : module.substr(sep+2);
+		}
+		return index;
+	}
+};
+
+// Logging threads read the routing inside an RCU read section, without locks; writers publish a new
+// snapshot and reclaim the previous one only after every reader that could have seen it has finished.
+struct HandlerRegistry {
+	struct Registered {
+		std::unique_ptr<Tial::Utility::Logger::Handler> handler;
+		std::vector<std::string> modules;
+	};
+
+	std::mutex mutex;
+	std::vector<Registered> owned;
+	uint64_t generation = 0;
+	Tial::Utility::Rcu::Pointer<Routing> active{std::make_unique<Routing>()};
+} handlers;
+
+}
+
+namespace {
+
+// per level value, counted by AsynchronousWriter::push
+std::atomic<uint64_t> droppedCounts[256];
+std::atomic<uint64_t> spilledCounts[256];
+
+class AsynchronousWriter {
+	static constexpr std::size_t batchSize = 256;
+
+	Tial::Utility::Logger::QueuePolicy policy;
+	// Critical and Warning
+	Tial::Utility::ConcurrentQueue<Tial::Utility::Logger::Message*> priorityQueue;
+	Tial::Utility::ConcurrentQueue<Tial::Utility::Logger::Message*> queue;
+	std::unique_ptr<Tial::Utility::Logger::Handlers::File> spill;
+	std::mutex mutex;
+	std::condition_variable wakeUp;
+	std::condition_variable drained;
+	std::atomic<bool> sleeping{false};
+	std::atomic<bool> busy{false};
+	bool stopping = false;
+	std::thread thread;
+
+	std::vector<Tial::Utility::Logger::Message*> batch;
+	// messages of the batch for each handler
+	std::vector<std::vector<const Tial::Utility::Logger::Message*>> routed;
+
+	// takes up to batchSize queued messages, writes them to the handlers and frees them; false if there were none
+	bool writeBatch() {
+		Tial::Utility::Logger::Message *message;
+		while(batch.size() < batchSize && (priorityQueue.pop(message) || queue.pop(message)))
+			batch.push_back(message);
+		if(batch.empty())
+			return false;
+
+		{
+			Tial::Utility::Rcu::ReadSection section;
+			const Routing *routing = handlers.active.get();
+			routed.resize(routing->handlers.size());
+			for(auto &&message: batch)
+				for(auto &&index: routing->route(*message->site).handlers)
+					routed[index].push_back(message);
+			for(std::size_t i = 0; i < routed.size(); ++i)
+				if(!routed[i].empty()) {
+					routing->handlers[i]->log(routed[i]);
+					routed[i].clear();
+				}
+		}
+		for(auto &&message: batch)
+			delete message;
+		batch.clear();
+		return true;
+	}
+
+	void run() {
+		Tial::Utility::Thread::setName("Logger");
+		batch.reserve(batchSize);
+		for(;;) {
+			busy.store(true);
+			if(writeBatch())
+				continue;
+
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				busy.store(false);
+				drained.notify_all();
+				if(stopping)
+					return;
+				sleeping.store(true);
+				if(priorityQueue.empty() && queue.empty())
+					wakeUp.wait_for(lock, 100ms);
+				sleeping.store(false);
+			}
+			Tial::Utility::Rcu::ReadSection section;
+			for(auto &&handler: handlers.active.get()->handlers)
+				handler->idle();
+		}
+	}
+
+public:
+	AsynchronousWriter(std::size_t queueSize, const Tial::Utility::Logger::QueuePolicy &policy): policy(policy),
+			priorityQueue(policy.priorityQueueSize), queue(queueSize) {
+		if(policy.overflow == Tial::Utility::Logger::QueuePolicy::Overflow::Spill)
+			spill = std::make_unique<Tial::Utility::Logger::Handlers::File>(Tial::Utility::Logger::Level::Nice3,
+				policy.spillFileName);
+		thread = std::thread([this](){ run(); });
+	}
+
+	~AsynchronousWriter() {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wakeUp.notify_one();
+		thread.join();
+		// pushed after the writer thread last found the queues empty
+		while(writeBatch());
+	}
+
+	void push(Tial::Utility::Logger::Message &&message) {
+		using Overflow = Tial::Utility::Logger::QueuePolicy::Overflow;
+		Tial::Utility::Logger::Message *record = new Tial::Utility::Logger::Message(std::move(message));
+		Tial::Utility::Logger::Level level = record->level;
+		bool priority = level >= Tial::Utility::Logger::Level::Warning;
+		auto &target = priority ? priorityQueue : queue;
+		bool waits = priority || policy.overflow == Overflow::Block
+			|| (policy.overflow == Overflow::DropBelow && level >= policy.level);
+		while(!target.push(std::move(record))) {
+			if(!waits) {
+				if(spill) {
+					spill->log(*record);
+					spilledCounts[static_cast<uint8_t>(level)].fetch_add(1, std::memory_order_relaxed);
+				} else {
+					droppedCounts[static_cast<uint8_t>(level)].fetch_add(1, std::memory_order_relaxed);
+				}
+				delete record;
+				wake();
+				return;
+			}
+			wake();
+			std::this_thread::yield();
+		}
+		if(sleeping.load())
+			wake();
+	}
+
+	void wake() {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+		}
+		wakeUp.notify_one();
+	}
+
+	void flush() {
+		std::unique_lock<std::mutex> lock(mutex);
+		wakeUp.notify_one();
+		drained.wait(lock, [this](){ return priorityQueue.empty() && queue.empty() && !busy.load(); });
+		if(spill)
+			spill->flush();
+	}
+
+	// crash handler only: takes queued messages without locking, waking or waiting for the writer thread
+	template<typename Function>
+	void emergencyDrain(Function &&function) {
+		if(spill)
+			spill->emergencyFlush();
+		Tial::Utility::Logger::Message *message;
+		while(priorityQueue.pop(message) || queue.pop(message))
+			function(*message);
+	}
+};
+
 }
 
-std::vector<std::unique_ptr<Tial::Utility::Logger::Handler>> handlers;
+static std::atomic<AsynchronousWriter*> asynchronousWriter{nullptr};
+
+static struct AsynchronousModeCleanup {
+	~AsynchronousModeCleanup() {
+		Tial::Utility::Logger::disableAsynchronousMode();
+	}
+} asynchronousModeCleanup;
+
+static void dispatch(const Tial::Utility::Logger::Message &message) {
+	Tial::Utility::Rcu::ReadSection section;
+	const Routing *routing = handlers.active.get();
+	for(auto &&index: routing->route(*message.site).handlers)
+		routing->handlers[index]->log(message);
+}
 
 Tial::Utility::Logger::Message::~Message() {
-	for(auto &&handler: handlers)
-		handler->log(*this);
+	if(!pending)
+		return;
+	pending = false;
+
+	// keeps disableAsynchronousMode from deleting the writer until the message is pushed
+	Tial::Utility::Rcu::ReadSection section;
+	AsynchronousWriter *writer = asynchronousWriter.load(std::memory_order_acquire);
+	if(writer)
+		writer->push(std::move(*this));
+	else
+		dispatch(*this);
 }
 
 Tial::Utility::Logger::Stream &Tial::Utility::Logger::Message::out() {
 	return stream;
 }
 
-std::unordered_map<std::string, Tial::Utility::Logger::Level> levels;
+namespace {
 
-bool Tial::Utility::Logger::toBeLoggedRuntime(Level level, const std::experimental::string_view &module) {
-	auto moduleLevel = levels.find(module.to_string());
-	if(moduleLevel == levels.end()) {
-		auto sep = module.rfind("::");
-		if(sep == module.npos)
-			return level >= globalLevel;
+// Module levels as a trie of "::"-separated name components. Published through RCU: readers never lock,
+// setLoggingLevel replaces the whole (small) tree with an updated copy.
+struct LevelNode {
+	bool hasLevel = false;
+	Tial::Utility::Logger::Level level = Tial::Utility::Logger::Level::Nice3;
+	std::map<std::string, std::unique_ptr<LevelNode>, std::less<>> children;
+
+	std::unique_ptr<LevelNode> clone() const {
+		auto result = std::make_unique<LevelNode>();
+		result->hasLevel = hasLevel;
+		result->level = level;
+		for(auto &&child: children)
+			result->children.emplace(child.first, child.second->clone());
+		return result;
+	}
+
+	// level of the longest configured prefix of module; the root always has a level
+	Tial::Utility::Logger::Level find(std::experimental::string_view module) const {
+		const LevelNode *node = this;
+		Tial::Utility::Logger::Level result = level;
+		while(!module.empty()) {
+			auto sep = module.find("::");
+			auto child = node->children.find(module.substr(0, sep));
+			if(child == node->children.end())
+				break;
+			node = child->second.get();
+			if(node->hasLevel)
+				result = node->level;
+			module = sep == module.npos ? std::experimental::string_view() : module.substr(sep+2);
+		}
+		return result;
+	}
+
+	void set(std::experimental::string_view module, Tial::Utility::Logger::Level level) {
+		LevelNode *node = this;
+		while(!module.empty()) {
+			auto sep = module.find("::");
+			auto &child = node->children[module.substr(0, sep).to_string()];
+			if(!child)
+				child = std::make_unique<LevelNode>();
+			node = child.get();
+			module = sep == module.npos ? std::experimental::string_view() : module.substr(sep+2);
+		}
+		node->hasLevel = true;
+		node->level = level;
+	}
+};
+
+Tial::Utility::Rcu::Pointer<LevelNode> &levels() {
+	static Tial::Utility::Rcu::Pointer<LevelNode> levels([](){
+		auto root = std::make_unique<LevelNode>();
+		root->hasLevel = true;
+		return root;
+	}());
+	return levels;
+}
+
+void updateLevels(std::experimental::string_view module, Tial::Utility::Logger::Level level) {
+	levels().update([module, level](const LevelNode &current) {
+		auto next = current.clone();
+		next->set(module, level);
+		return next;
+	});
+	++Tial::Utility::Logger::_levelsGeneration;
+}
+
+}
+
+namespace {
+
+struct StaticKeyRange {
+	const Tial::Utility::Logger::StaticKey *end;
+	std::size_t registrations;
+	std::size_t dormant;
+};
+
+// leaked, so that binaries unloaded during exit may still unregister
+struct StaticKeyRegistry {
+	std::mutex mutex;
+	std::map<const Tial::Utility::Logger::StaticKey*, StaticKeyRange> ranges;
+	// set by the first level or handler change; until then every site stays branch-guarded
+	bool active = false;
+	// code could not be made writable; sites stay branch-guarded for good
+	bool failed = false;
+};
+
+StaticKeyRegistry &staticKeys() {
+	static StaticKeyRegistry *registry = new StaticKeyRegistry;
+	return *registry;
+}
+
+#if (defined __linux__) && (defined __x86_64__)
+// Writes the first 5 bytes of the aligned word at each key.code: a jump to key.target or a 5-byte no-op.
+// Other threads may be executing the instruction meanwhile. The 5 bytes never cross an 8-byte boundary, so the
+// whole word is replaced by one aligned store, and x86-64 instruction fetch sees either the old or the new word,
+// never a mix; both are complete instructions, the same guarantee that lets JIT compilers patch running call
+// sites without an int3 step. Until a CPU serializes it may still run the old instruction, which only costs one
+// more or one fewer message, so membarrier serializes every CPU running this process before an update returns;
+// kernels without it give up only that bound. Pages stay executable while writable, because other threads may
+// be running code on them, and each page is made writable once per update.
+bool patch(const std::vector<std::pair<const Tial::Utility::Logger::StaticKey*, bool>> &keys) {
+	std::vector<std::pair<uint64_t*, uint64_t>> words;
+	for(auto &&key: keys) {
+		uint64_t bytes = 0x0000441f0full;
+		if(key.second) {
+			uint32_t offset = static_cast<uint32_t>(key.first->target - (key.first->code + 5));
+			bytes = 0xe9 | (static_cast<uint64_t>(offset) << 8);
+		}
+		uint64_t *word = reinterpret_cast<uint64_t*>(key.first->code);
+		uint64_t current = __atomic_load_n(word, __ATOMIC_RELAXED);
+		uint64_t next = (current & ~0xffffffffffull) | bytes;
+		if(next != current)
+			words.emplace_back(word, next);
+	}
+	if(words.empty())
+		return true;
+	std::sort(words.begin(), words.end());
+
+	static const uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+	static const bool serialize = ::syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED_SYNC_CORE, 0) == 0;
+	bool success = true;
+	for(auto word = words.begin(); word != words.end();) {
+		uintptr_t page = reinterpret_cast<uintptr_t>(word->first) & ~(pageSize - 1);
+		auto end = std::find_if(word, words.end(), [page](const std::pair<uint64_t*, uint64_t> &other) {
+			return (reinterpret_cast<uintptr_t>(other.first) & ~(pageSize - 1)) != page;
+		});
+		if(mprotect(reinterpret_cast<void*>(page), pageSize, PROT_READ | PROT_WRITE | PROT_EXEC) == 0) {
+			for(; word != end; ++word)
+				__atomic_store_n(word->first, word->second, __ATOMIC_SEQ_CST);
+			mprotect(reinterpret_cast<void*>(page), pageSize, PROT_READ | PROT_EXEC);
+		} else {
+			success = false;
+			word = end;
+		}
+	}
+	if(serialize)
+		::syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED_SYNC_CORE, 0);
+	return success;
+}
+#else
+bool patch(const std::vector<std::pair<const Tial::Utility::Logger::StaticKey*, bool>> &keys) {
+	return keys.empty();
+}
+#endif
+
+// called with registry.mutex held; patches the keys of one range, or of all of them without begin
+void applyStaticKeys(StaticKeyRegistry &registry, const Tial::Utility::Logger::StaticKey *begin = nullptr) {
+	std::vector<std::pair<const Tial::Utility::Logger::StaticKey*, bool>> keys;
+	for(auto &&range: registry.ranges) {
+		if(begin && range.first != begin)
+			continue;
+		range.second.dormant = 0;
+		for(auto key = range.first; key != range.second.end; ++key) {
+			bool enabled = registry.failed || Tial::Utility::Logger::toBeLoggedRuntime(
+				static_cast<Tial::Utility::Logger::Level>(key->level), key->module);
+			if(!enabled)
+				++range.second.dormant;
+			keys.emplace_back(key, enabled);
+		}
+	}
+	if(patch(keys) || registry.failed)
+		return;
+	// some code is not writable: put back every jump replaced so far and stop patching
+	registry.failed = true;
+	applyStaticKeys(registry);
+}
+
+// after every change of module levels or handlers
+void updateStaticKeys() {
+	StaticKeyRegistry &registry = staticKeys();
+	std::unique_lock<std::mutex> lock(registry.mutex);
+	registry.active = true;
+	applyStaticKeys(registry);
+}
+
+}
+
+void Tial::Utility::Logger::_registerStaticKeys(const StaticKey *begin, const StaticKey *end) {
+	if(begin == end)
+		return;
+	StaticKeyRegistry &registry = staticKeys();
+	std::unique_lock<std::mutex> lock(registry.mutex);
+	StaticKeyRange &range = registry.ranges[begin];
+	range.end = end;
+	if(range.registrations++ == 0 && registry.active)
+		applyStaticKeys(registry, begin);
+}
+
+void Tial::Utility::Logger::_unregisterStaticKeys(const StaticKey *begin) {
+	StaticKeyRegistry &registry = staticKeys();
+	std::unique_lock<std::mutex> lock(registry.mutex);
+	auto found = registry.ranges.find(begin);
+	if(found != registry.ranges.end() && --found->second.registrations == 0)
+		registry.ranges.erase(found);
+}
+
+std::size_t Tial::Utility::Logger::dormantSites() {
+	StaticKeyRegistry &registry = staticKeys();
+	std::unique_lock<std::mutex> lock(registry.mutex);
+	std::size_t dormant = 0;
+	for(auto &&range: registry.ranges)
+		dormant += range.second.dormant;
+	return dormant;
+}
+
+// generation 0 is never used, so zero-initialized sites are always refreshed on first use
+std::atomic<uint64_t> Tial::Utility::Logger::_levelsGeneration{1};
+
+// lowest level accepted by any registered handler, recomputed under handlers.mutex; nothing passes the initial value
+static std::atomic<uint8_t> handlersLevel{std::numeric_limits<uint8_t>::max()};
+
+// called under handlers.mutex after any change to the registered handlers or their levels
+static void updateRouting() {
+	auto next = std::make_unique<Routing>();
+	next->generation = ++handlers.generation;
+	std::vector<std::vector<std::size_t>> subscribed(1);
+	for(auto &&registered: handlers.owned) {
+		std::size_t index = next->handlers.size();
+		next->handlers.push_back(registered.handler.get());
+		if(registered.modules.empty())
+			subscribed[0].push_back(index);
+		for(auto &&module: registered.modules) {
+			std::size_t route = next->insert(module);
+			subscribed.resize(next->routes.size());
+			subscribed[route].push_back(index);
+		}
+	}
 
-		return toBeLoggedRuntime(level, module.substr(0, sep));
+	// a child is always inserted after its parent, so parents are complete when their children are visited
+	uint8_t lowest = std::numeric_limits<uint8_t>::max();
+	std::vector<std::size_t> parents(next->routes.size());
+	for(std::size_t i = 0; i < next->routes.size(); ++i) {
+		Route &route = next->routes[i];
+		for(auto &&child: route.children)
+			parents[child.second] = i;
+		if(i > 0)
+			route.handlers = next->routes[parents[i]].handlers;
+		route.handlers.insert(route.handlers.end(), subscribed[i].begin(), subscribed[i].end());
+		std::sort(route.handlers.begin(), route.handlers.end());
+		route.handlers.erase(std::unique(route.handlers.begin(), route.handlers.end()), route.handlers.end());
+		for(auto &&index: route.handlers)
+			route.level = std::min(route.level, static_cast<uint8_t>(next->handlers[index]->level()));
+		lowest = std::min(lowest, route.level);
 	}
-	return level >= moduleLevel->second;
+
+	handlers.active.update([&next](const Routing&) { return std::move(next); });
+	handlersLevel.store(lowest);
+	// after publishing: sites refreshed against the previous routing are refreshed again
+	++Tial::Utility::Logger::_levelsGeneration;
+	updateStaticKeys();
+}
+
+bool Tial::Utility::Logger::toBeLoggedRuntime(Level level, const std::experimental::string_view &module) {
+	Tial::Utility::Rcu::ReadSection section;
+	const Routing *routing = handlers.active.get();
+	uint8_t threshold = std::max(static_cast<uint8_t>(levels().get()->find(module)),
+		routing->routes[routing->find(module)].level);
+	return static_cast<uint8_t>(level) >= threshold;
+}
+
+uint64_t Tial::Utility::Logger::_updateSiteLevel(const Site &site) {
+	// generation is read first: an update published meanwhile bumps it again and forces another refresh
+	uint64_t generation = _levelsGeneration.load();
+	Tial::Utility::Rcu::ReadSection section;
+	uint8_t level = std::max(static_cast<uint8_t>(levels().get()->find(site.module)),
+		handlers.active.get()->route(site).level);
+	uint64_t threshold = (generation << 8) | level;
+	site.threshold.store(threshold, std::memory_order_relaxed);
+	return threshold;
 }
 
 void Tial::Utility::Logger::setLoggingLevel(Level level) {
-	globalLevel = level;
+	updateLevels(std::experimental::string_view(), level);
+	updateStaticKeys();
 }
 
 void Tial::Utility::Logger::setLoggingLevel(Level level, const std::experimental::string_view &module) {
-	levels[module.to_string()] = level;
+	updateLevels(module, level);
+	updateStaticKeys();
+}
+
+Tial::Utility::Logger::Handler::Handler(Level level): accepted(level) {}
+
+Tial::Utility::Logger::Level Tial::Utility::Logger::Handler::level() const {
+	return accepted.load(std::memory_order_relaxed);
 }
 
-Tial::Utility::Logger::Handler::Handler(Level level): level(level) {}
+void Tial::Utility::Logger::Handler::setLevel(Level level) {
+	std::unique_lock<std::mutex> lock(handlers.mutex);
+	accepted.store(level, std::memory_order_relaxed);
+	updateRouting();
+}
 
 void Tial::Utility::Logger::Handler::log(const Message &message) {
-	if(message.level >= level)
+	if(message.level >= level())
 		write(message);
 }
 
-void Tial::Utility::Logger::addHandler(std::unique_ptr<Handler> &&handler) {
-	handlers.push_back(std::move(handler));
+void Tial::Utility::Logger::Handler::log(const std::vector<const Message*> &messages) {
+	Level level = this->level();
+	std::vector<const Message*> accepted;
+	accepted.reserve(messages.size());
+	for(auto &&message: messages)
+		if(message->level >= level)
+			accepted.push_back(message);
+	if(!accepted.empty())
+		writeBatch(accepted);
+}
+
+void Tial::Utility::Logger::Handler::writeBatch(const std::vector<const Message*> &messages) {
+	for(auto &&message: messages)
+		write(*message);
+}
+
+void Tial::Utility::Logger::Handler::flush() {}
+
+void Tial::Utility::Logger::Handler::idle() {}
+
+int Tial::Utility::Logger::Handler::emergencyFlush() {
+	return -1;
+}
+
+void Tial::Utility::Logger::addHandler(std::unique_ptr<Handler> &&handler, const std::vector<std::string> &modules) {
+	std::unique_lock<std::mutex> lock(handlers.mutex);
+	handlers.owned.push_back({std::move(handler), modules});
+	updateRouting();
+}
+
+std::unique_ptr<Tial::Utility::Logger::Handler> Tial::Utility::Logger::removeHandler(Handler *handler) {
+	std::unique_lock<std::mutex> lock(handlers.mutex);
+	auto found = std::find_if(handlers.owned.begin(), handlers.owned.end(),
+			[handler](const HandlerRegistry::Registered &registered) { return registered.handler.get() == handler; });
+	if(found == handlers.owned.end())
+		return nullptr;
+
+	std::unique_ptr<Handler> removed = std::move(found->handler);
+	handlers.owned.erase(found);
+	// the update returns only after readers of the previous routing are gone, so nothing uses the handler anymore
+	updateRouting();
+	return removed;
+}
+
+Tial::Utility::Logger::Level Tial::Utility::Logger::acceptedLevel() {
+	return static_cast<Level>(handlersLevel.load());
+}
+
+Tial::Utility::Logger::QueuePolicy::QueuePolicy(): overflow(Overflow::Block), level(Level::Info),
+	priorityQueueSize(1024) {}
+
+void Tial::Utility::Logger::enableAsynchronousMode(std::size_t queueSize, const QueuePolicy &policy) {
+	if(asynchronousWriter.load())
+		disableAsynchronousMode();
+	asynchronousWriter.store(new AsynchronousWriter(queueSize, policy), std::memory_order_release);
+}
+
+void Tial::Utility::Logger::disableAsynchronousMode() {
+	AsynchronousWriter *writer = asynchronousWriter.exchange(nullptr);
+	if(!writer)
+		return;
+	// waits for threads that loaded the writer before the exchange to finish pushing to it
+	Tial::Utility::Rcu::synchronize();
+	delete writer;
+}
+
+uint64_t Tial::Utility::Logger::droppedMessages(Level level) {
+	return droppedCounts[static_cast<uint8_t>(level)].load(std::memory_order_relaxed);
+}
+
+uint64_t Tial::Utility::Logger::spilledMessages(Level level) {
+	return spilledCounts[static_cast<uint8_t>(level)].load(std::memory_order_relaxed);
+}
+
+void Tial::Utility::Logger::flush() {
+	Tial::Utility::Rcu::ReadSection section;
+	AsynchronousWriter *writer = asynchronousWriter.load(std::memory_order_acquire);
+	if(writer)
+		writer->flush();
+	for(auto &&handler: handlers.active.get()->handlers)
+		handler->flush();
+}
+
+// async-signal-safe
+static void writeRaw(int descriptor, std::experimental::string_view text) {
+	while(!text.empty()) {
+		ssize_t written = ::write(descriptor, text.data(), text.size());
+		if(written < 0) {
+			if(errno == EINTR)
+				continue;
+			return;
+		}
+		text.remove_prefix(static_cast<std::size_t>(written));
+	}
+}
+
+namespace {
+
+const int crashSignals[] = {SIGSEGV, SIGABRT, SIGBUS, SIGILL, SIGFPE};
+
+std::atomic<bool> crashing{false};
+
+const char *crashSignalName(int signal) {
+	switch(signal) {
+	case SIGSEGV: return "SIGSEGV";
+	case SIGABRT: return "SIGABRT";
+	case SIGBUS: return "SIGBUS";
+	case SIGILL: return "SIGILL";
+	case SIGFPE: return "SIGFPE";
+	default: return "signal";
+	}
+}
+
+// Only async-signal-safe calls from here on: no locks, no allocation, no formatting through Layout.
+void crashHandler(int signal) {
+	if(crashing.exchange(true)) {
+		// another thread is reporting; it re-raises its signal, which ends the process
+		for(;;)
+			::pause();
+	}
+
+	int descriptors[16] = {STDERR_FILENO};
+	std::size_t count = 1;
+	// no read section: handlers are not removed concurrently with a crash in any meaningful program
+	for(auto &&handler: handlers.active.get()->handlers) {
+		int descriptor = handler->emergencyFlush();
+		if(descriptor < 0 || count == sizeof(descriptors)/sizeof(descriptors[0])
+				|| std::find(descriptors, descriptors + count, descriptor) != descriptors + count)
+			continue;
+		descriptors[count++] = descriptor;
+	}
+
+	AsynchronousWriter *writer = asynchronousWriter.load(std::memory_order_acquire);
+	if(writer)
+		writer->emergencyDrain([&descriptors, count](const Tial::Utility::Logger::Message &message) {
+			for(std::size_t i = 0; i < count; ++i) {
+				writeRaw(descriptors[i], "unwritten message\t");
+				writeRaw(descriptors[i], message.site->module);
+				writeRaw(descriptors[i], "\t");
+				writeRaw(descriptors[i], message.stream.view());
+				writeRaw(descriptors[i], "\n");
+			}
+		});
+
+	for(std::size_t i = 0; i < count; ++i) {
+		writeRaw(descriptors[i], "*** ");
+		writeRaw(descriptors[i], crashSignalName(signal));
+		writeRaw(descriptors[i], " received, stack trace:\n");
+		Tial::Utility::ABI::writeStackTrace(descriptors[i]);
+	}
+
+	// the handler was reset to the default action when entered
+	::raise(signal);
+}
+
+}
+
+void Tial::Utility::Logger::installCrashHandler() {
+	// backtrace may allocate when first called, which must not happen in the signal handler
+	void *frame;
+	backtrace(&frame, 1);
+
+	static bool stackInstalled = false;
+	if(!stackInstalled) {
+		stackInstalled = true;
+		// stays allocated for the lifetime of the thread; lets the handler run after a stack overflow
+		stack_t stack{};
+		stack.ss_size = std::max<std::size_t>(SIGSTKSZ, 64*1024);
+		stack.ss_sp = new char[stack.ss_size];
+		::sigaltstack(&stack, nullptr);
+	}
+
+	struct sigaction action{};
+	action.sa_handler = crashHandler;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESETHAND | SA_ONSTACK;
+	for(int signal: crashSignals)
+		::sigaction(signal, &action, nullptr);
+}
+
+namespace {
+
+// constant-initialized, so limiters of any translation unit may register during static initialization
+struct LimiterRegistry {
+	std::mutex mutex;
+	Tial::Utility::Logger::Limiter *first = nullptr;
+	// in steady clock nanoseconds
+	std::atomic<int64_t> interval{10000000000};
+	std::atomic<int64_t> nextReport{0};
+} limiters;
+
+int64_t steadyNanoseconds() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Reports suppressed messages once the interval since the first unreported one has passed, so that the counts
+// of a storm that has ended still come out. Leaked and detached, so that exit never waits for it; a process
+// forked off starts its own on its first suppression.
+class SuppressionTimer {
+	std::mutex mutex;
+	std::condition_variable wakeUp;
+	pid_t process = 0;
+
+	void run() {
+		Tial::Utility::Thread::setName("LoggerSuppressed");
+		std::unique_lock<std::mutex> lock(mutex);
+		for(;;) {
+			int64_t next = limiters.nextReport.load();
+			int64_t now = steadyNanoseconds();
+			if(next == 0)
+				wakeUp.wait(lock);
+			else if(now < next)
+				wakeUp.wait_for(lock, std::chrono::nanoseconds(next - now));
+			else if(limiters.nextReport.compare_exchange_strong(next, 0)) {
+				// cleared first, so that a message suppressed meanwhile arms the next report
+				lock.unlock();
+				Tial::Utility::Logger::reportSuppressed();
+				lock.lock();
+			}
+		}
+	}
+
+public:
+	void arm() {
+		std::unique_lock<std::mutex> lock(mutex);
+		if(process != ::getpid()) {
+			process = ::getpid();
+			std::thread([this](){ run(); }).detach();
+		}
+		wakeUp.notify_one();
+	}
+};
+
+SuppressionTimer &suppressionTimer() {
+	static SuppressionTimer *timer = new SuppressionTimer;
+	return *timer;
+}
+
+}
+
+Tial::Utility::Logger::Limiter::Limiter(const Site &site, Level level): site(site), level(level) {
+	std::unique_lock<std::mutex> lock(limiters.mutex);
+	next = limiters.first;
+	if(next)
+		next->previous = this;
+	limiters.first = this;
+}
+
+Tial::Utility::Logger::Limiter::~Limiter() {
+	std::unique_lock<std::mutex> lock(limiters.mutex);
+	if(previous)
+		previous->next = next;
+	else
+		limiters.first = next;
+	if(next)
+		next->previous = previous;
+}
+
+bool Tial::Utility::Logger::Limiter::suppress() {
+	suppressed.fetch_add(1, std::memory_order_relaxed);
+	// only the first message suppressed since the last report schedules the next one
+	if(limiters.nextReport.load(std::memory_order_relaxed) == 0) {
+		int64_t interval = limiters.interval.load(std::memory_order_relaxed);
+		int64_t expected = 0;
+		if(interval > 0 && limiters.nextReport.compare_exchange_strong(expected, steadyNanoseconds() + interval))
+			suppressionTimer().arm();
+	}
+	return false;
+}
+
+void Tial::Utility::Logger::reportSuppressed() {
+	std::vector<std::pair<const Limiter*, uint64_t>> reports;
+	{
+		std::unique_lock<std::mutex> lock(limiters.mutex);
+		for(Limiter *limiter = limiters.first; limiter; limiter = limiter->next)
+			if(uint64_t count = limiter->suppressed.exchange(0, std::memory_order_relaxed))
+				reports.emplace_back(limiter, count);
+	}
+	for(auto &&report: reports)
+		if(toBeLoggedRuntime(report.first->level, report.first->site))
+			Message(report.first->site, report.first->level, std::chrono::system_clock::now()).out()
+				<< report.second << " similar messages suppressed";
+}
+
+void Tial::Utility::Logger::setSuppressionReportInterval(std::chrono::steady_clock::duration interval) {
+	limiters.interval.store(std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count());
+	limiters.nextReport.store(0);
 }
 
-Tial::Utility::Logger::Handlers::StandardOutput::StandardOutput(Level level, bool colors)
-	: Handler(level), colors(colors) {}
+Tial::Utility::Logger::Handlers::StandardOutput::StandardOutput(Level level, bool colors, const std::string &pattern)
+	: Handler(level), colors(colors), layout(pattern) {}
 
-static std::string printLevel(Tial::Utility::Logger::Level level, bool adjustSpaces = true) {
+static std::experimental::string_view levelName(Tial::Utility::Logger::Level level, bool adjustSpaces = true) {
+	std::experimental::string_view name;
 	switch(level) {
-	case Tial::Utility::Logger::Level::Critical: return "CRITICAL"s + (adjustSpaces ?  "" : ""); break;
-	case Tial::Utility::Logger::Level::Warning:  return "WARNING"s + (adjustSpaces ?  " " : ""); break;
-	case Tial::Utility::Logger::Level::Info:     return "INFO"s + (adjustSpaces ?  "    " : ""); break;
-	case Tial::Utility::Logger::Level::Debug:    return "DEBUG"s + (adjustSpaces ?  "   " : ""); break;
-	case Tial::Utility::Logger::Level::Nice1:    return "NICE1"s + (adjustSpaces ?  "   " : ""); break;
-	case Tial::Utility::Logger::Level::Nice2:    return "NICE2"s + (adjustSpaces ?  "   " : ""); break;
-	case Tial::Utility::Logger::Level::Nice3:    return "NICE3"s + (adjustSpaces ?  "   " : ""); break;
-	default:                                        return "UNKNOWN"s + (adjustSpaces ?  " " : ""); break;
+	case Tial::Utility::Logger::Level::Critical: name = "CRITICAL"; break;
+	case Tial::Utility::Logger::Level::Warning:  name = "WARNING "; break;
+	case Tial::Utility::Logger::Level::Info:     name = "INFO    "; break;
+	case Tial::Utility::Logger::Level::Debug:    name = "DEBUG   "; break;
+	case Tial::Utility::Logger::Level::Nice1:    name = "NICE1   "; break;
+	case Tial::Utility::Logger::Level::Nice2:    name = "NICE2   "; break;
+	case Tial::Utility::Logger::Level::Nice3:    name = "NICE3   "; break;
+	default:                                     name = "UNKNOWN "; break;
 	}
+	return adjustSpaces ? name : name.substr(0, name.find(' '));
 }
 
 #define ColorReset         "\x1B[0m"
@@ -301,42 +1373,187 @@ static std::string colorCodeReset() {
 	return ColorReset;
 }
 
+constexpr char Tial::Utility::Logger::Layout::console[];
+constexpr char Tial::Utility::Logger::Layout::file[];
+
+Tial::Utility::Logger::Layout::Layout(const std::string &pattern, Values values): values(values) {
+	static const std::pair<std::experimental::string_view, Field> fields[] = {
+		// longer names first, so that a name is never matched by its prefix
+		{"timestamp", Field::Timestamp},
+		{"time", Field::Time},
+		{"level", Field::Level},
+		{"thread", Field::Thread},
+		{"module", Field::Module},
+		{"fields", Field::Fields},
+		{"file", Field::File},
+		{"line", Field::Line},
+		{"function", Field::Function},
+		{"msg", Field::Message}
+	};
+
+	std::string text;
+	std::size_t i = 0;
+	while(i < pattern.size()) {
+		if(pattern[i] != '%') {
+			text += pattern[i++];
+			continue;
+		}
+		if(++i < pattern.size() && pattern[i] == '%') {
+			text += pattern[i++];
+			continue;
+		}
+		if(!text.empty()) {
+			ops.push_back({Field::Text, text, 0});
+			text.clear();
+		}
+
+		if(i < pattern.size() && pattern[i] == '|') {
+			std::size_t begin = ++i;
+			while(i < pattern.size() && pattern[i] >= '0' && pattern[i] <= '9')
+				++i;
+			if(i == begin)
+				THROW Exception("Missing column width in layout pattern: " + pattern);
+			ops.push_back({Field::Column, std::string(), std::stoul(pattern.substr(begin, i - begin))});
+			continue;
+		}
+
+		auto field = std::find_if(std::begin(fields), std::end(fields), [&pattern, i](const auto &field) {
+			return pattern.compare(i, field.first.size(), field.first.data(), field.first.size()) == 0;
+		});
+		if(field == std::end(fields))
+			THROW Exception("Unknown field in layout pattern: " + pattern);
+		ops.push_back({field->second, std::string(), 0});
+		i += field->first.size();
+	}
+	if(!text.empty())
+		ops.push_back({Field::Text, text, 0});
+}
+
+void Tial::Utility::Logger::Layout::format(const Message &message, std::string &output) const {
+	bool escaped = values == Values::Escaped;
+	std::size_t column = output.size();
+	for(auto &&op: ops) {
+		switch(op.field) {
+		case Field::Text:
+			output += op.text;
+			break;
+		case Field::Time:
+			if(message.formattedTimeLength == 0)
+				message.formattedTimeLength = Time::formatTimestamp(message.time, message.formattedTime);
+			output.append(message.formattedTime, message.formattedTimeLength);
+			break;
+		case Field::Timestamp:
+			appendSigned(output,
+				std::chrono::duration_cast<std::chrono::microseconds>(message.time.time_since_epoch()).count());
+			break;
+		case Field::Level: {
+			auto name = levelName(message.level, !escaped);
+			output.append(name.data(), name.size());
+			break;
+		}
+		case Field::Thread:
+			if(escaped)
+				appendEscaped(output, message.thread);
+			else
+				output += message.thread;
+			break;
+		case Field::Module:
+			if(escaped)
+				appendEscaped(output, message.site->module);
+			else
+				appendAbbreviated(output, message.site->module);
+			break;
+		case Field::File:
+			if(escaped)
+				appendEscaped(output, message.site->file);
+			else
+				appendFileName(output, message.site->file);
+			break;
+		case Field::Line:
+			appendUnsigned(output, message.site->line);
+			break;
+		case Field::Function:
+			if(escaped)
+				appendEscaped(output, message.site->function);
+			else
+				appendAbbreviated(output, message.site->function);
+			break;
+		case Field::Message:
+			if(escaped) {
+				appendEscaped(output, message.stream.view());
+			} else {
+				auto text = message.stream.view();
+				output.append(text.data(), text.size());
+			}
+			break;
+		case Field::Fields:
+			message.stream.fields.forEach([&output, escaped](const Fields::Field &field) {
+				output += ' ';
+				if(escaped)
+					appendEscaped(output, field.key);
+				else
+					output.append(field.key.data(), field.key.size());
+				output += '=';
+				if(field.type == Fields::Type::String) {
+					output += '"';
+					if(escaped)
+						appendEscaped(output, field.stringValue);
+					else
+						output.append(field.stringValue.data(), field.stringValue.size());
+					output += '"';
+				} else {
+					appendValue(output, field);
+				}
+			});
+			break;
+		case Field::Column:
+			if(output.size() - column < op.width)
+				output.append(op.width - (output.size() - column), ' ');
+			column = output.size();
+			break;
+		}
+	}
+}
+
+namespace {
+
+thread_local std::string scratchLine;
+thread_local bool scratchUsed = false;
+
+// Per-thread line buffer of handlers, keeping its capacity between messages. A handler logging while it
+// formats (nested use) gets a temporary string instead.
+class Scratch {
+	std::string own;
+	bool shared;
+public:
+	Scratch(): shared(!scratchUsed) {
+		if(shared) {
+			scratchUsed = true;
+			scratchLine.clear();
+		}
+	}
+
+	~Scratch() {
+		if(shared)
+			scratchUsed = false;
+	}
+
+	std::string &line() {
+		return shared ? scratchLine : own;
+	}
+};
+
+}
+
 void Tial::Utility::Logger::Handlers::StandardOutput::write(const Message &message) {
-	std::ostringstream oss;
-	oss << Utility::Time::timeCast(message.time) << " ";
-	oss << printLevel(message.level) << " ";
-	oss << Tial::Utility::Thread::name() << " ";
-	std::string column0 = oss.str();
-	while(column0.length() < 50)
-		column0 += " ";
-
-	oss = std::ostringstream();
-	oss << limitString(message.module) << " ";
-	std::string column1 = oss.str();
-	while(column1.length() < 30)
-		column1 += " ";
-
-	oss = std::ostringstream();
-	oss << limitFileName(message.file) << ":";
-	oss << message.line << ":";
-	oss << limitString(message.function) << " ";
-	std::string column2 = oss.str();
-	while(column2.length() < 50)
-		column2 += " ";
-
-	oss = std::ostringstream();
-	oss << message.stream.output();
-	std::string column3 = oss.str();
-
-	oss = std::ostringstream();
+	Scratch scratch;
+	std::string &line = scratch.line();
 	if(colors)
-		oss << levelColorCode(message.level);
-	oss << column0 << column1 << column2 << column3;
+		line += levelColorCode(message.level);
+	layout.format(message, line);
 	if(colors)
-		oss << colorCodeReset();
-	oss << std::endl;
-
-	std::string line = oss.str();
+		line += colorCodeReset();
+	line += '\n';
 
 	{
 		std::unique_lock<std::mutex> lock(output);
@@ -346,38 +1563,1411 @@ void Tial::Utility::Logger::Handlers::StandardOutput::write(const Message &messa
 	}
 }
 
+void Tial::Utility::Logger::Handlers::StandardOutput::writeBatch(const std::vector<const Message*> &messages) {
+	Scratch scratch;
+	std::string &lines = scratch.line();
+	for(auto &&message: messages) {
+		if(colors)
+			lines += levelColorCode(message->level);
+		layout.format(*message, lines);
+		if(colors)
+			lines += colorCodeReset();
+		lines += '\n';
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(output);
+
+		std::cerr.write(lines.data(), lines.size());
+		std::cerr.flush();
+	}
+}
+
 static std::string processLogFileName(std::string pattern) {
-	boost::algorithm::replace_all(pattern, "%t", Tial::Utility::Time::timeCast(std::chrono::system_clock::now()));
+	boost::algorithm::replace_all(pattern, "%t", Tial::Utility::Time::formatTimestamp(std::chrono::system_clock::now()));
 	return pattern;
 }
 
-Tial::Utility::Logger::Handlers::File::File(Level level, const std::string &fileName)
-	: Handler(level), fileName(processLogFileName(fileName)) {}
+Tial::Utility::Logger::Handlers::File::FlushPolicy::FlushPolicy(): bytes(0), interval(1s), critical(true) {}
+
+Tial::Utility::Logger::Handlers::File::RotationPolicy::RotationPolicy(): bytes(0), interval(0), segments(0), compress(false) {}
 
-const std::string fieldSeparator = "\t";
+static bool compressFile(const std::string &source, const std::string &target) {
+	int input = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+	if(input < 0)
+		return false;
+	gzFile output = gzopen(target.c_str(), "wb");
+	if(!output) {
+		::close(input);
+		return false;
+	}
 
-std::string escape(std::string str) {
-	boost::algorithm::replace_all(str, "\\", "\\\\");
-	boost::algorithm::replace_all(str, fieldSeparator, "\\t");
-	boost::algorithm::replace_all(str, "\n", "\\n");
-	return str;
+	bool success = true;
+	std::vector<char> chunk(64*1024);
+	for(;;) {
+		ssize_t count = ::read(input, chunk.data(), chunk.size());
+		if(count < 0 && errno == EINTR)
+			continue;
+		if(count <= 0) {
+			success = (count == 0);
+			break;
+		}
+		if(gzwrite(output, chunk.data(), static_cast<unsigned int>(count)) != count) {
+			success = false;
+			break;
+		}
+	}
+	success = (gzclose(output) == Z_OK) && success;
+	::close(input);
+
+	if(success)
+		::unlink(source.c_str());
+	else
+		::unlink(target.c_str());
+	return success;
+}
+
+// what Time::formatTimestamp produces, with every digit as 0
+static const char timestampShape[] = "0000-00-00T00:00:00.000000";
+static const std::size_t timestampLength = sizeof(timestampShape)-1;
+
+static bool isTimestamp(const std::string &text, std::string::size_type position) {
+	if(position > text.size() || text.size() - position < timestampLength)
+		return false;
+	for(std::size_t i = 0; i < timestampLength; ++i) {
+		char c = text[position+i];
+		if(timestampShape[i] == '0' ? (c < '0' || c > '9') : c != timestampShape[i])
+			return false;
+	}
+	return true;
+}
+
+// whether name is a segment of pattern: every %t expanded, or the timestamp that rotate() appends when there is
+// none, then the numeric suffix File::open adds to a name already taken, then .gz of a compressed segment
+static bool isSegment(std::string pattern, const std::string &name) {
+	if(pattern.find("%t") == std::string::npos)
+		pattern += ".%t";
+	std::string::size_type position = 0;
+	for(std::string::size_type i = 0; i < pattern.size();) {
+		if(pattern.compare(i, 2, "%t") == 0) {
+			if(!isTimestamp(name, position))
+				return false;
+			position += timestampLength;
+			i += 2;
+		} else {
+			if(position >= name.size() || name[position] != pattern[i])
+				return false;
+			++position;
+			++i;
+		}
+	}
+
+	std::string rest = name.substr(position);
+	if(rest.size() >= 3 && rest.compare(rest.size()-3, 3, ".gz") == 0)
+		rest.resize(rest.size()-3);
+	return rest.empty() || (rest.size() > 1 && rest[0] == '.'
+		&& rest.find_first_not_of("0123456789", 1) == std::string::npos);
+}
+
+// segments left by earlier runs of the same pattern, oldest first; the timestamps sort as text
+static std::deque<std::string> existingSegments(const std::string &pattern, const std::string &active) {
+	std::string::size_type slash = pattern.rfind('/');
+	std::string directory = slash == std::string::npos ? std::string() : pattern.substr(0, slash+1);
+	std::string base = pattern.substr(directory.size());
+	std::deque<std::string> result;
+	if(directory.find("%t") != std::string::npos)
+		return result;
+
+	DIR *listing = ::opendir(directory.empty() ? "." : directory.c_str());
+	if(!listing)
+		return result;
+	while(struct dirent *entry = ::readdir(listing)) {
+		std::string name = entry->d_name;
+		if(isSegment(base, name) && directory + name != active)
+			result.push_back(directory + name);
+	}
+	::closedir(listing);
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+static void writeAll(int descriptor, std::vector<iovec> &vectors) {
+	std::size_t first = 0;
+	while(first < vectors.size()) {
+		int count = static_cast<int>(std::min<std::size_t>(vectors.size() - first, IOV_MAX));
+		ssize_t written = ::writev(descriptor, &vectors[first], count);
+		if(written < 0) {
+			if(errno == EINTR)
+				continue;
+			return;
+		}
+		std::size_t remaining = static_cast<std::size_t>(written);
+		while(first < vectors.size() && remaining >= vectors[first].iov_len)
+			remaining -= vectors[first++].iov_len;
+		if(remaining > 0) {
+			vectors[first].iov_base = static_cast<char*>(vectors[first].iov_base) + remaining;
+			vectors[first].iov_len -= remaining;
+		}
+	}
+}
+
+// finishes closed segments: writes what was still buffered for them, closes, compresses and prunes them
+class Tial::Utility::Logger::Handlers::File::Segments {
+	struct Pending {
+		std::string name;
+		int descriptor;
+		std::string buffer;
+	};
+
+	std::mutex mutex;
+	std::condition_variable wakeUp;
+	std::deque<Pending> pending;
+	std::deque<std::string> closed;
+	std::size_t limit;
+	bool compress;
+	bool stopping = false;
+	std::thread thread;
+
+	void prune() {
+		while(limit > 0 && closed.size() > limit) {
+			::unlink(closed.front().c_str());
+			closed.pop_front();
+		}
+	}
+
+	void process(Pending &&next) {
+		if(!next.buffer.empty()) {
+			std::vector<iovec> vectors{{&next.buffer[0], next.buffer.size()}};
+			writeAll(next.descriptor, vectors);
+		}
+		if(next.descriptor >= 0)
+			::close(next.descriptor);
+
+		std::string segment = std::move(next.name);
+		if(compress && compressFile(segment, segment + ".gz"))
+			segment += ".gz";
+		closed.push_back(segment);
+		prune();
+	}
+
+	void run() {
+		Tial::Utility::Thread::setName("LoggerSegments");
+		std::unique_lock<std::mutex> lock(mutex);
+		for(;;) {
+			wakeUp.wait(lock, [this](){ return stopping || !pending.empty(); });
+			if(pending.empty())
+				return;
+			Pending next = std::move(pending.front());
+			pending.pop_front();
+			lock.unlock();
+			process(std::move(next));
+			lock.lock();
+		}
+	}
+
+public:
+	Segments(std::size_t limit, bool compress, std::deque<std::string> &&existing)
+		: closed(std::move(existing)), limit(limit), compress(compress) {
+		prune();
+		thread = std::thread([this](){ run(); });
+	}
+
+	~Segments() {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wakeUp.notify_one();
+		thread.join();
+	}
+
+	// takes over the descriptor and the data buffered for it
+	void add(const std::string &segment, int descriptor, std::string &&buffer) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			pending.push_back(Pending{segment, descriptor, std::move(buffer)});
+		}
+		wakeUp.notify_one();
+	}
+};
+
+Tial::Utility::Logger::Handlers::File::File(Level level, const std::string &fileName, const FlushPolicy &policy,
+	std::size_t bufferSize, const RotationPolicy &rotation, const std::string &layoutPattern
+): Handler(level), pattern(fileName), policy(policy), bufferSize(bufferSize),
+	lastFlush(std::chrono::steady_clock::now()), descriptor(-1), rotation(rotation), fileSize(0),
+	layout(layoutPattern, Layout::Values::Escaped) {
+	buffer.reserve(bufferSize);
+	descriptor = open(std::string(), this->fileName, fileSize);
+	opened = std::chrono::steady_clock::now();
+	if(descriptor < 0)
+		THROW Exception("Cannot open log file " + this->fileName);
+	if(rotation.bytes > 0 || rotation.interval.count() > 0)
+		segments = std::make_unique<Segments>(rotation.segments, rotation.compress,
+			rotation.segments > 0 ? existingSegments(pattern, this->fileName) : std::deque<std::string>());
+}
+
+Tial::Utility::Logger::Handlers::File::~File() {
+	flushBuffer();
+	if(descriptor >= 0)
+		::close(descriptor);
+}
+
+// opens the next file of the pattern, named differently from current; returns its descriptor, or -1
+int Tial::Utility::Logger::Handlers::File::open(const std::string &current, std::string &name, std::size_t &size) const {
+	name = processLogFileName(pattern);
+	if(name == current)
+		name += "." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+	int descriptor = ::open(name.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
+	struct stat status;
+	size = (descriptor >= 0 && ::fstat(descriptor, &status) == 0) ? static_cast<std::size_t>(status.st_size) : 0;
+	return descriptor;
+}
+
+// Called with output locked. The next file is opened with output unlocked, so other threads keep appending to
+// the current one meanwhile; the current descriptor and its buffered data are then handed to segments.
+void Tial::Utility::Logger::Handlers::File::rotate(std::unique_lock<std::mutex> &lock) {
+	rotating = true;
+	std::string current = fileName;
+	lock.unlock();
+
+	std::string segment = current;
+	if(pattern.find("%t") == std::string::npos) {
+		// the next file takes over the name, which is free only once the current one is renamed
+		segment = current + "." + Tial::Utility::Time::formatTimestamp(std::chrono::system_clock::now());
+		::rename(current.c_str(), segment.c_str());
+		current.clear();
+	}
+	std::string name;
+	std::size_t size;
+	int next = open(current, name, size);
+
+	lock.lock();
+	rotating = false;
+	segments->add(segment, descriptor, std::move(buffer));
+	buffer = std::string();
+	buffer.reserve(bufferSize);
+	descriptor = next;
+	fileName = name;
+	fileSize = size;
+	opened = lastFlush = std::chrono::steady_clock::now();
+}
+
+std::string Tial::Utility::Logger::Handlers::File::currentFileName() {
+	std::unique_lock<std::mutex> lock(output);
+	return fileName;
+}
+
+std::string Tial::Utility::Logger::Handlers::File::format(const Message &message) {
+	static const Layout layout(Layout::file, Layout::Values::Escaped);
+	std::string line;
+	layout.format(message, line);
+	line += '\n';
+	return line;
+}
+
+Tial::Utility::Logger::Handlers::JsonLines::JsonLines(Level level, const std::string &fileName, const FlushPolicy &policy,
+		std::size_t bufferSize, const RotationPolicy &rotation): File(level, fileName, policy, bufferSize, rotation) {}
+
+int Tial::Utility::Logger::Handlers::JsonLines::emergencyFlush() {
+	File::emergencyFlush();
+	return -1;
+}
+
+namespace {
+
+// characters that need escaping in a JSON string: quote, backslash and control characters
+struct JsonSpecial {
+	bool table[256];
+
+	JsonSpecial(): table() {
+		for(int c = 0; c < 0x20; ++c)
+			table[c] = true;
+		table[static_cast<unsigned char>('"')] = true;
+		table[static_cast<unsigned char>('\\')] = true;
+	}
+};
+
+const JsonSpecial jsonSpecial;
+
+// appends s as a quoted JSON string, copying runs of ordinary characters at once
+void appendJson(std::string &output, const std::experimental::string_view &s) {
+	static const char hex[] = "0123456789abcdef";
+	output += '"';
+	std::size_t run = 0;
+	for(std::size_t i = 0; i < s.size(); ++i) {
+		unsigned char c = s[i];
+		if(!jsonSpecial.table[c])
+			continue;
+		output.append(s.data() + run, i - run);
+		run = i + 1;
+		switch(c) {
+		case '"': output += "\\\""; break;
+		case '\\': output += "\\\\"; break;
+		case '\n': output += "\\n"; break;
+		case '\t': output += "\\t"; break;
+		case '\r': output += "\\r"; break;
+		default:
+			output += "\\u00";
+			output += hex[c >> 4];
+			output += hex[c & 0xf];
+			break;
+		}
+	}
+	output.append(s.data() + run, s.size() - run);
+	output += '"';
+}
+
+}
+
+void Tial::Utility::Logger::Handlers::JsonLines::formatLine(const Message &message, std::string &output) const {
+	output += "{\"timestamp\":";
+	appendSigned(output, std::chrono::duration_cast<std::chrono::microseconds>(message.time.time_since_epoch()).count());
+	output += ",\"level\":";
+	appendJson(output, levelName(message.level, false));
+	output += ",\"thread\":";
+	appendJson(output, message.thread);
+	output += ",\"module\":";
+	appendJson(output, message.site->module);
+	output += ",\"file\":";
+	appendJson(output, message.site->file);
+	output += ",\"line\":";
+	appendUnsigned(output, message.site->line);
+	output += ",\"function\":";
+	appendJson(output, message.site->function);
+	output += ",\"message\":";
+	appendJson(output, message.stream.view());
+	if(!message.stream.fields.empty()) {
+		output += ",\"fields\":{";
+		bool first = true;
+		message.stream.fields.forEach([&output, &first](const Fields::Field &field) {
+			if(!first)
+				output += ',';
+			first = false;
+			appendJson(output, field.key);
+			output += ':';
+			if(field.type == Fields::Type::String)
+				appendJson(output, field.stringValue);
+			else if(field.type == Fields::Type::Floating && !std::isfinite(field.floatingValue))
+				output += "null";
+			else
+				appendValue(output, field);
+		});
+		output += '}';
+	}
+	output += "}\n";
+}
+
+void Tial::Utility::Logger::Handlers::File::flushBuffer() {
+	if(!buffer.empty()) {
+		std::vector<iovec> vectors{{&buffer[0], buffer.size()}};
+		writeAll(descriptor, vectors);
+		buffer.clear();
+	}
+	lastFlush = std::chrono::steady_clock::now();
+}
+
+void Tial::Utility::Logger::Handlers::File::append(const std::string &lines, bool critical) {
+	std::size_t size = lines.size();
+
+	std::unique_lock<std::mutex> lock(output);
+	if(segments && !rotating && ((rotation.bytes > 0 && fileSize > 0 && fileSize + size > rotation.bytes)
+			|| (rotation.interval.count() > 0 && std::chrono::steady_clock::now() - opened >= rotation.interval)))
+		rotate(lock);
+	fileSize += size;
+
+	if(buffer.size() + size > bufferSize) {
+		std::vector<iovec> vectors;
+		if(!buffer.empty())
+			vectors.push_back({&buffer[0], buffer.size()});
+		vectors.push_back({const_cast<char*>(lines.data()), lines.size()});
+		writeAll(descriptor, vectors);
+		buffer.clear();
+		lastFlush = std::chrono::steady_clock::now();
+		return;
+	}
+
+	buffer += lines;
+	if((critical && policy.critical)
+			|| (policy.bytes > 0 && buffer.size() >= policy.bytes)
+			|| (policy.interval.count() > 0 && std::chrono::steady_clock::now() - lastFlush >= policy.interval))
+		flushBuffer();
+}
+
+void Tial::Utility::Logger::Handlers::File::formatLine(const Message &message, std::string &output) const {
+	layout.format(message, output);
+	output += '\n';
 }
 
 void Tial::Utility::Logger::Handlers::File::write(const Message &message) {
+	Scratch scratch;
+	std::string &line = scratch.line();
+	formatLine(message, line);
+	append(line, message.level == Level::Critical);
+}
+
+void Tial::Utility::Logger::Handlers::File::writeBatch(const std::vector<const Message*> &messages) {
+	Scratch scratch;
+	std::string &lines = scratch.line();
+	bool critical = false;
+	for(auto &&message: messages) {
+		formatLine(*message, lines);
+		critical = critical || message->level == Level::Critical;
+	}
+	append(lines, critical);
+}
 
-	std::ostringstream oss;
-	oss << std::chrono::duration_cast<std::chrono::microseconds>(message.time.time_since_epoch()).count() << fieldSeparator;
-	oss << escape(printLevel(message.level, false)) << fieldSeparator;
-	oss << escape(Tial::Utility::Thread::name()) << fieldSeparator;
-	oss << escape(message.module) << fieldSeparator;
-	oss << escape(message.file) << fieldSeparator;
-	oss << message.line << fieldSeparator;
-	oss << escape(message.function) << fieldSeparator;
-	oss << escape(message.stream.output());
+void Tial::Utility::Logger::Handlers::File::flush() {
+	std::unique_lock<std::mutex> lock(output);
+	flushBuffer();
+}
+
+void Tial::Utility::Logger::Handlers::File::idle() {
+	std::unique_lock<std::mutex> lock(output);
+	if(!buffer.empty() && policy.interval.count() > 0 && std::chrono::steady_clock::now() - lastFlush >= policy.interval)
+		flushBuffer();
+}
+
+int Tial::Utility::Logger::Handlers::File::emergencyFlush() {
+	if(descriptor < 0)
+		return -1;
+	writeRaw(descriptor, std::experimental::string_view(buffer.data(), buffer.size()));
+	buffer.clear();
+	return descriptor;
+}
+
+constexpr char Tial::Utility::Logger::Handlers::Binary::magic[];
+
+class Tial::Utility::Logger::Handlers::Binary::Dictionary {
+	// call sites are static, so their addresses identify them for the lifetime of the handler
+	typedef std::pair<const Site*, Level> SiteKey;
+
+	struct SiteKeyHash {
+		std::size_t operator()(const SiteKey &key) const {
+			return std::hash<const Site*>()(key.first) ^ static_cast<std::size_t>(key.second);
+		}
+	};
+
+	std::unordered_map<SiteKey, uint32_t, SiteKeyHash> siteIds;
+	std::deque<std::string> threads;
+	std::unordered_map<std::experimental::string_view, uint32_t> threadIds;
+
+public:
+	template<typename T>
+	static void put(std::string &buffer, const T &value) {
+		buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	static void putString(std::string &buffer, const std::experimental::string_view &string) {
+		put(buffer, static_cast<uint32_t>(string.size()));
+		buffer.append(string.data(), string.size());
+	}
+
+	uint32_t site(std::string &buffer, const Message &message) {
+		auto found = siteIds.find({message.site, message.level});
+		if(found != siteIds.end())
+			return found->second;
+
+		uint32_t id = static_cast<uint32_t>(siteIds.size());
+		siteIds.emplace(SiteKey(message.site, message.level), id);
+
+		put(buffer, Record::Site);
+		put(buffer, id);
+		put(buffer, static_cast<uint32_t>(message.site->line));
+		put(buffer, message.level);
+		putString(buffer, message.site->file);
+		putString(buffer, message.site->function);
+		putString(buffer, message.site->module);
+		return id;
+	}
+
+	uint32_t thread(std::string &buffer, const std::string &name) {
+		auto found = threadIds.find(name);
+		if(found != threadIds.end())
+			return found->second;
+
+		uint32_t id = static_cast<uint32_t>(threads.size());
+		threads.push_back(name);
+		threadIds.emplace(threads.back(), id);
+
+		put(buffer, Record::Thread);
+		put(buffer, id);
+		putString(buffer, name);
+		return id;
+	}
+};
 
+class Tial::Utility::Logger::Handlers::Deduplicate::Timer {
+	Deduplicate &owner;
+	std::mutex mutex;
+	std::condition_variable wakeUp;
+	Message::TimePoint deadline;
+	bool armed = false;
+	bool stopping = false;
+	std::thread thread;
+
+	void run() {
+		Tial::Utility::Thread::setName("LoggerDeduplicate");
+		std::unique_lock<std::mutex> lock(mutex);
+		while(!stopping) {
+			if(!armed)
+				wakeUp.wait(lock);
+			else if(std::chrono::system_clock::now() < deadline)
+				wakeUp.wait_until(lock, deadline);
+			else {
+				armed = false;
+				lock.unlock();
+				owner.expire();
+				lock.lock();
+			}
+		}
+	}
+
+public:
+	explicit Timer(Deduplicate &owner): owner(owner) {
+		thread = std::thread([this](){ run(); });
+	}
+
+	~Timer() {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wakeUp.notify_one();
+		thread.join();
+	}
+
+	void arm(Message::TimePoint time) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			deadline = time;
+			armed = true;
+		}
+		wakeUp.notify_one();
+	}
+};
+
+Tial::Utility::Logger::Handlers::Deduplicate::Deduplicate(Level level, std::unique_ptr<Handler> &&handler,
+		std::chrono::milliseconds window): Handler(level), handler(std::move(handler)), window(window) {
+	if(window.count() > 0)
+		timer = std::make_unique<Timer>(*this);
+}
+
+Tial::Utility::Logger::Handlers::Deduplicate::~Deduplicate() {
+	timer.reset();
+	flush();
+}
+
+void Tial::Utility::Logger::Handlers::Deduplicate::collapse(const Message &message, std::vector<const Message*> &output,
+		std::deque<Message> &summaries) {
+	std::experimental::string_view view = message.stream.view();
+	std::size_t messageHash = std::hash<std::experimental::string_view>()(view);
+	if(message.site == site && message.level == lastLevel && messageHash == hash && view == text
+			&& message.time - first < window) {
+		if(!repeats++)
+			timer->arm(first + window);
+		last = message.time;
+		return;
+	}
+
+	report(output, summaries);
+	site = message.site;
+	lastLevel = message.level;
+	hash = messageHash;
+	text.assign(view.data(), view.size());
+	thread = message.thread;
+	first = last = message.time;
+	output.push_back(&message);
+}
+
+void Tial::Utility::Logger::Handlers::Deduplicate::report(std::vector<const Message*> &output,
+		std::deque<Message> &summaries) {
+	if(!repeats)
+		return;
+	// moved-from messages are detached, so the summary goes only to the wrapped handler
+	Message pending(*site, lastLevel, last);
+	summaries.emplace_back(std::move(pending));
+	summaries.back().thread = thread;
+	summaries.back().out() << "last message repeated " << repeats << " times";
+	output.push_back(&summaries.back());
+	repeats = 0;
+}
+
+void Tial::Utility::Logger::Handlers::Deduplicate::write(const Message &message) {
+	std::unique_lock<std::mutex> lock(mutex);
+	std::vector<const Message*> output;
+	std::deque<Message> summaries;
+	collapse(message, output, summaries);
+	if(!output.empty())
+		handler->log(output);
+}
+
+void Tial::Utility::Logger::Handlers::Deduplicate::writeBatch(const std::vector<const Message*> &messages) {
+	std::unique_lock<std::mutex> lock(mutex);
+	std::vector<const Message*> output;
+	std::deque<Message> summaries;
+	output.reserve(messages.size());
+	for(auto &&message: messages)
+		collapse(*message, output, summaries);
+	if(!output.empty())
+		handler->log(output);
+}
+
+void Tial::Utility::Logger::Handlers::Deduplicate::flush() {
 	{
-		std::unique_lock<std::mutex> lock(output);
-		std::ofstream of(fileName, std::ios::app);
-		of << oss.str() << std::endl;
+		std::unique_lock<std::mutex> lock(mutex);
+		std::vector<const Message*> output;
+		std::deque<Message> summaries;
+		report(output, summaries);
+		if(!output.empty())
+			handler->log(output);
+	}
+	handler->flush();
+}
+
+void Tial::Utility::Logger::Handlers::Deduplicate::expire() {
+	std::unique_lock<std::mutex> lock(mutex);
+	if(repeats && std::chrono::system_clock::now() - first >= window) {
+		std::vector<const Message*> output;
+		std::deque<Message> summaries;
+		report(output, summaries);
+		handler->log(output);
+	}
+}
+
+void Tial::Utility::Logger::Handlers::Deduplicate::idle() {
+	expire();
+	handler->idle();
+}
+
+int Tial::Utility::Logger::Handlers::Deduplicate::emergencyFlush() {
+	return handler->emergencyFlush();
+}
+
+Tial::Utility::Logger::Handlers::Binary::Binary(Level level, const std::string &fileName, std::size_t bufferSize)
+	: Handler(level), bufferSize(bufferSize), dictionary(std::make_unique<Dictionary>()) {
+	std::string name = processLogFileName(fileName);
+	descriptor = ::open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if(descriptor < 0)
+		THROW Exception("Cannot open log file " + name);
+	buffer.reserve(bufferSize);
+	buffer.append(magic, sizeof(magic) - 1);
+}
+
+Tial::Utility::Logger::Handlers::Binary::~Binary() {
+	flushBuffer();
+	::close(descriptor);
+}
+
+void Tial::Utility::Logger::Handlers::Binary::flushBuffer() {
+	if(buffer.empty())
+		return;
+	std::vector<iovec> vectors{{&buffer[0], buffer.size()}};
+	writeAll(descriptor, vectors);
+	buffer.clear();
+}
+
+void Tial::Utility::Logger::Handlers::Binary::append(const Message &message) {
+	uint32_t site = dictionary->site(buffer, message);
+	uint32_t thread = dictionary->thread(buffer, message.thread);
+	std::experimental::string_view payload = message.stream.view();
+
+	Dictionary::put(buffer, Record::Message);
+	Dictionary::put(buffer, site);
+	Dictionary::put(buffer, thread);
+	Dictionary::put(buffer, static_cast<int64_t>(
+		std::chrono::duration_cast<std::chrono::microseconds>(message.time.time_since_epoch()).count()
+	));
+	Dictionary::putString(buffer, payload);
+}
+
+void Tial::Utility::Logger::Handlers::Binary::write(const Message &message) {
+	std::unique_lock<std::mutex> lock(output);
+	append(message);
+	if(buffer.size() >= bufferSize || message.level == Level::Critical)
+		flushBuffer();
+}
+
+void Tial::Utility::Logger::Handlers::Binary::writeBatch(const std::vector<const Message*> &messages) {
+	std::unique_lock<std::mutex> lock(output);
+	bool critical = false;
+	for(auto &&message: messages) {
+		append(*message);
+		critical = critical || message->level == Level::Critical;
+	}
+	if(buffer.size() >= bufferSize || critical)
+		flushBuffer();
+}
+
+void Tial::Utility::Logger::Handlers::Binary::flush() {
+	std::unique_lock<std::mutex> lock(output);
+	flushBuffer();
+}
+
+int Tial::Utility::Logger::Handlers::Binary::emergencyFlush() {
+	writeRaw(descriptor, std::experimental::string_view(buffer.data(), buffer.size()));
+	buffer.clear();
+	return -1;
+}
+
+namespace {
+
+class BinaryReader {
+	std::ifstream input;
+	std::string fileName;
+
+public:
+	explicit BinaryReader(const std::string &fileName): input(fileName, std::ios::binary), fileName(fileName) {
+		if(!input)
+			THROW Tial::Utility::Exception("Cannot open binary log file " + fileName);
+	}
+
+	bool eof() {
+		return input.peek() == std::char_traits<char>::eof();
+	}
+
+	void read(char *data, std::size_t size) {
+		if(!input.read(data, size))
+			THROW Tial::Utility::Exception("Truncated binary log file " + fileName);
+	}
+
+	template<typename T>
+	T get() {
+		T value;
+		read(reinterpret_cast<char*>(&value), sizeof(value));
+		return value;
+	}
+
+	std::string getString() {
+		std::string string(get<uint32_t>(), '\0');
+		if(!string.empty())
+			read(&string[0], string.size());
+		return string;
+	}
+};
+
+// owns the strings a decoded call site refers to
+struct BinarySite {
+	std::string file;
+	std::string function;
+	std::string module;
+	Tial::Utility::Logger::Level level;
+	Tial::Utility::Logger::Site site;
+};
+
+}
+
+void Tial::Utility::Logger::Handlers::Binary::decode(const std::string &fileName,
+		const std::function<void(const Message&)> &callback) {
+	BinaryReader reader(fileName);
+
+	std::string header(sizeof(magic) - 1, '\0');
+	reader.read(&header[0], header.size());
+	if(header != magic)
+		THROW Exception("Not a binary log file: " + fileName);
+
+	std::deque<BinarySite> sites;
+	std::vector<std::string> threads;
+	while(!reader.eof()) {
+		switch(reader.get<Record>()) {
+		case Record::Site: {
+			uint32_t id = reader.get<uint32_t>();
+			if(id != sites.size())
+				THROW Exception("Unexpected call site id in " + fileName);
+			sites.emplace_back();
+			BinarySite &site = sites.back();
+			site.site.line = reader.get<uint32_t>();
+			site.level = reader.get<Level>();
+			site.file = reader.getString();
+			site.function = reader.getString();
+			site.module = reader.getString();
+			site.site.file = site.file;
+			site.site.function = site.function;
+			site.site.prettyFunction = site.function;
+			site.site.module = site.module;
+			break;
+		}
+		case Record::Thread: {
+			uint32_t id = reader.get<uint32_t>();
+			if(id != threads.size())
+				THROW Exception("Unexpected thread id in " + fileName);
+			threads.push_back(reader.getString());
+			break;
+		}
+		case Record::Message: {
+			uint32_t site = reader.get<uint32_t>();
+			uint32_t thread = reader.get<uint32_t>();
+			int64_t time = reader.get<int64_t>();
+			std::string payload = reader.getString();
+			if(site >= sites.size() || thread >= threads.size())
+				THROW Exception("Message references unknown dictionary entry in " + fileName);
+
+			const BinarySite &s = sites[site];
+			Message::TimePoint timePoint(
+				std::chrono::duration_cast<Message::TimePoint::duration>(std::chrono::microseconds(time))
+			);
+			// moving detaches the message, so that it reaches only the callback; a temporary could be elided
+			Message pending(s.site, s.level, timePoint);
+			Message message(std::move(pending));
+			message.thread = threads[thread];
+			message.out().append(payload.data(), payload.size());
+			callback(message);
+			break;
+		}
+		default:
+			THROW Exception("Unknown record type in " + fileName);
+		}
+	}
+}
+
+constexpr char Tial::Utility::Logger::Handlers::FlightRecorder::magic[];
+
+// first bytes of the file, followed by the ring
+struct Tial::Utility::Logger::Handlers::FlightRecorder::Header {
+	char magic[8];
+	uint64_t capacity;
+	// bytes ever reserved; also the position in the ring (modulo capacity) where the next record starts
+	std::atomic<uint64_t> position;
+};
+
+namespace {
+
+constexpr std::size_t flightRecorderHeaderSize = 64;
+
+// Precedes every record in the ring, records being aligned to 8 bytes. The position (which never repeats)
+// is stored last, so a record is recognized only if it was written completely and is still in the ring.
+struct FlightRecord {
+	uint64_t position;
+	uint32_t size;
+	uint32_t line;
+	int64_t time;
+	Tial::Utility::Logger::Level level;
+	uint8_t reserved;
+	uint16_t module;
+	uint16_t file;
+	uint16_t function;
+	uint16_t thread;
+	uint32_t text;
+};
+
+static_assert(sizeof(FlightRecord) == 40, "Unexpected padding of flight recorder record header");
+
+std::experimental::string_view truncated(const std::experimental::string_view &string) {
+	return string.substr(0, std::numeric_limits<uint16_t>::max());
+}
+
+}
+
+Tial::Utility::Logger::Handlers::FlightRecorder::FlightRecorder(Level level, const std::string &fileName,
+		std::size_t capacity): Handler(level), capacity((std::max<std::size_t>(capacity, 4096) + 7) & ~std::size_t(7)) {
+	static_assert(sizeof(Header) <= flightRecorderHeaderSize, "Flight recorder header does not fit");
+	std::string name = processLogFileName(fileName);
+	descriptor = ::open(name.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if(descriptor < 0)
+		THROW Exception("Cannot open log file " + name);
+
+	const std::size_t fileSize = flightRecorderHeaderSize + this->capacity;
+	struct stat status;
+	bool reuse = ::fstat(descriptor, &status) == 0 && static_cast<std::size_t>(status.st_size) == fileSize;
+	if(!reuse && (::ftruncate(descriptor, 0) != 0 || ::ftruncate(descriptor, fileSize) != 0)) {
+		::close(descriptor);
+		THROW Exception("Cannot resize log file " + name);
+	}
+
+	void *address = ::mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+	if(address == MAP_FAILED) {
+		::close(descriptor);
+		THROW Exception("Cannot map log file " + name);
+	}
+	mapping = static_cast<char*>(address);
+	ring = mapping + flightRecorderHeaderSize;
+
+	header = reinterpret_cast<Header*>(mapping);
+	if(!reuse || std::memcmp(header->magic, magic, sizeof(header->magic)) != 0 || header->capacity != this->capacity) {
+		std::memset(mapping, 0, fileSize);
+		header = new(mapping) Header;
+		std::memcpy(header->magic, magic, sizeof(header->magic));
+		header->capacity = this->capacity;
+		header->position.store(0);
+	}
+}
+
+Tial::Utility::Logger::Handlers::FlightRecorder::~FlightRecorder() {
+	::munmap(mapping, flightRecorderHeaderSize + capacity);
+	::close(descriptor);
+}
+
+void Tial::Utility::Logger::Handlers::FlightRecorder::put(uint64_t position, const void *data, std::size_t size) {
+	std::size_t offset = position % capacity;
+	std::size_t first = std::min(size, capacity - offset);
+	std::memcpy(ring + offset, data, first);
+	std::memcpy(ring, static_cast<const char*>(data) + first, size - first);
+}
+
+void Tial::Utility::Logger::Handlers::FlightRecorder::write(const Message &message) {
+	std::experimental::string_view module = truncated(message.site->module);
+	std::experimental::string_view file = truncated(message.site->file);
+	std::experimental::string_view function = truncated(message.site->function);
+	std::experimental::string_view thread = truncated(message.thread);
+	std::experimental::string_view text = message.stream.view();
+
+	// a single record may take at most a quarter of the ring
+	std::size_t size = sizeof(FlightRecord) + module.size() + file.size() + function.size() + thread.size();
+	if(size >= capacity/4)
+		return;
+	text = text.substr(0, capacity/4 - size);
+	size += text.size();
+
+	FlightRecord record;
+	record.size = size;
+	record.line = message.site->line;
+	record.time = std::chrono::duration_cast<std::chrono::microseconds>(message.time.time_since_epoch()).count();
+	record.level = message.level;
+	record.reserved = 0;
+	record.module = module.size();
+	record.file = file.size();
+	record.function = function.size();
+	record.thread = thread.size();
+	record.text = text.size();
+
+	uint64_t position = header->position.fetch_add((size + 7) & ~std::size_t(7), std::memory_order_relaxed);
+	uint64_t next = position + sizeof(FlightRecord);
+	for(auto &&string: {module, file, function, thread, text}) {
+		put(next, string.data(), string.size());
+		next += string.size();
+	}
+	put(position + sizeof(record.position), reinterpret_cast<const char*>(&record) + sizeof(record.position),
+		sizeof(FlightRecord) - sizeof(record.position));
+	std::atomic_thread_fence(std::memory_order_release);
+	// positions are aligned to 8 bytes, so this never wraps around the end of the ring
+	std::memcpy(ring + position % capacity, &position, sizeof(position));
+}
+
+void Tial::Utility::Logger::Handlers::FlightRecorder::flush() {
+	::msync(mapping, flightRecorderHeaderSize + capacity, MS_ASYNC);
+}
+
+void Tial::Utility::Logger::Handlers::FlightRecorder::decode(const std::string &fileName,
+		const std::function<void(const Message&)> &callback, std::size_t bytes) {
+	std::ifstream input(fileName, std::ios::binary);
+	if(!input)
+		THROW Exception("Cannot open flight recorder file " + fileName);
+	std::string content((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+	if(content.size() < flightRecorderHeaderSize || content.compare(0, sizeof(magic) - 1, magic) != 0)
+		THROW Exception("Not a flight recorder file: " + fileName);
+	uint64_t capacity, end;
+	std::memcpy(&capacity, &content[sizeof(Header::magic)], sizeof(capacity));
+	std::memcpy(&end, &content[sizeof(Header::magic) + sizeof(capacity)], sizeof(end));
+	if(capacity == 0 || capacity % 8 != 0 || content.size() != flightRecorderHeaderSize + capacity)
+		THROW Exception("Corrupted flight recorder file " + fileName);
+	const char *ring = content.data() + flightRecorderHeaderSize;
+
+	uint64_t begin = end > capacity ? end - capacity : 0;
+	if(bytes && end - begin > bytes)
+		begin = end - bytes;
+
+	auto get = [ring, capacity](uint64_t position, void *data, std::size_t size) {
+		std::size_t offset = position % capacity;
+		std::size_t first = std::min<std::size_t>(size, capacity - offset);
+		std::memcpy(data, ring + offset, first);
+		std::memcpy(static_cast<char*>(data) + first, ring, size - first);
+	};
+
+	// the record boundaries are unknown, so every aligned offset is a candidate
+	std::vector<uint64_t> positions;
+	for(uint64_t offset = 0; offset < capacity; offset += 8) {
+		uint64_t position;
+		std::memcpy(&position, ring + offset, sizeof(position));
+		if(position % capacity != offset || position < begin || position >= end)
+			continue;
+		FlightRecord record;
+		get(position, &record, sizeof(record));
+		std::size_t strings = std::size_t(record.module) + record.file + record.function + record.thread + record.text;
+		if(record.size != sizeof(record) + strings || position + record.size > end)
+			continue;
+		positions.push_back(position);
+	}
+	std::sort(positions.begin(), positions.end());
+
+	for(auto &&position: positions) {
+		FlightRecord record;
+		get(position, &record, sizeof(record));
+		uint64_t next = position + sizeof(record);
+		auto string = [&](std::size_t size) {
+			std::string result(size, '\0');
+			get(next, &result[0], size);
+			next += size;
+			return result;
+		};
+		std::string module = string(record.module);
+		std::string file = string(record.file);
+		std::string function = string(record.function);
+		std::string thread = string(record.thread);
+		std::string text = string(record.text);
+
+		Site site{file, record.line, function, function, module};
+		Message pending(site, record.level,
+			Message::TimePoint(std::chrono::duration_cast<Message::TimePoint::duration>(std::chrono::microseconds(record.time))));
+		Message message(std::move(pending));
+		message.thread = thread;
+		message.out().append(text.data(), text.size());
+		callback(message);
+	}
+}
+
+constexpr char Tial::Utility::Logger::Handlers::SharedRing::magic[];
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Shared memory ring needs lock-free 64-bit atomics");
+
+// the mapped ring; the process creating it initializes the slots before marking it ready
+class Tial::Utility::Logger::Handlers::SharedRing::Segment {
+public:
+	struct Header {
+		char magic[8];
+		uint32_t slots;
+		uint32_t slotSize;
+		std::atomic<uint32_t> ready;
+		alignas(64) std::atomic<uint64_t> head;
+		alignas(64) std::atomic<uint64_t> tail;
+		std::atomic<uint64_t> dropped;
+	};
+
+	// Slot for position p is free when its sequence is p and committed when it is p+1; consuming it sets
+	// the sequence to p+slots, freeing it for the next lap. The collector marks a slot it gave up waiting for
+	// as p|abandoned; its writer may still be filling it, so only that writer frees it, when it is done.
+	struct Slot {
+		std::atomic<uint64_t> sequence;
+		// position and process of the last writer claiming the slot, to tell whether it is still alive
+		std::atomic<uint64_t> claimed;
+		std::atomic<uint32_t> process;
+		uint32_t size;
+	};
+
+	static constexpr uint64_t abandoned = uint64_t(1) << 63;
+
+	static constexpr std::size_t headerSize = 256;
+	static_assert(sizeof(Header) <= headerSize, "Shared ring header does not fit");
+
+	Header *header;
+
+	Segment(const std::string &name, std::size_t slots, std::size_t slotSize);
+	~Segment();
+
+	Slot &slot(uint64_t position) {
+		return *reinterpret_cast<Slot*>(mapping + headerSize + (position % header->slots)*header->slotSize);
+	}
+
+	// frees an abandoned slot for the lap after the one it was abandoned in, if its writer died
+	bool reclaim(Slot &slot, uint64_t sequence) {
+		uint64_t position = sequence & ~abandoned;
+		if(slot.claimed.load(std::memory_order_acquire) != position)
+			return false;
+		pid_t process = slot.process.load(std::memory_order_relaxed);
+		if(::kill(process, 0) == 0 || errno != ESRCH)
+			return false;
+		slot.sequence.compare_exchange_strong(sequence, position + header->slots);
+		return true;
+	}
+
+	static char *payload(Slot &slot) {
+		return reinterpret_cast<char*>(&slot + 1);
+	}
+
+	std::size_t payloadCapacity() const {
+		return header->slotSize - sizeof(Slot);
+	}
+
+	static std::string path(const std::string &name) {
+		return !name.empty() && name[0] == '/' ? name : "/" + name;
+	}
+
+private:
+	char *mapping;
+	std::size_t size;
+};
+
+namespace {
+
+// payload of a shared ring slot, followed by the strings
+struct SharedRecord {
+	int64_t time;
+	uint32_t line;
+	uint32_t process;
+	Tial::Utility::Logger::Level level;
+	uint8_t reserved;
+	uint16_t module;
+	uint16_t file;
+	uint16_t function;
+	uint16_t thread;
+	uint32_t text;
+};
+
+static_assert(sizeof(SharedRecord) == 32, "Unexpected padding of shared ring record");
+
+template<typename Condition>
+bool waitFor(const Condition &condition) {
+	for(int i = 0; i < 1000; ++i) {
+		if(condition())
+			return true;
+		std::this_thread::sleep_for(1ms);
+	}
+	return condition();
+}
+
+}
+
+Tial::Utility::Logger::Handlers::SharedRing::Segment::Segment(const std::string &name, std::size_t slots,
+		std::size_t slotSize) {
+	const std::string path = Segment::path(name);
+	int descriptor = ::shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	const bool creator = descriptor >= 0;
+	if(!creator && errno == EEXIST)
+		descriptor = ::shm_open(path.c_str(), O_RDWR | O_CLOEXEC, 0);
+	if(descriptor < 0)
+		THROW Exception("Cannot open shared memory log ring " + path);
+
+	if(creator) {
+		slots = std::max<std::size_t>(slots, 2);
+		slotSize = (std::max<std::size_t>(slotSize, 128) + 63) & ~std::size_t(63);
+		size = headerSize + slots*slotSize;
+		if(::ftruncate(descriptor, size) != 0) {
+			::close(descriptor);
+			::shm_unlink(path.c_str());
+			THROW Exception("Cannot resize shared memory log ring " + path);
+		}
+	} else {
+		// the creator may not have sized the object yet
+		struct stat status;
+		if(!waitFor([&](){ return ::fstat(descriptor, &status) == 0 && status.st_size > 0; })) {
+			::close(descriptor);
+			THROW Exception("Shared memory log ring " + path + " was not initialized");
+		}
+		size = status.st_size;
 	}
+
+	void *address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+	::close(descriptor);
+	if(address == MAP_FAILED)
+		THROW Exception("Cannot map shared memory log ring " + path);
+	mapping = static_cast<char*>(address);
+
+	if(creator) {
+		header = new(mapping) Header;
+		header->slots = slots;
+		header->slotSize = slotSize;
+		header->head.store(0);
+		header->tail.store(0);
+		header->dropped.store(0);
+		for(std::size_t i = 0; i < slots; ++i)
+			new(&slot(i)) Slot{{i}, {0}, {0}, 0};
+		std::memcpy(header->magic, magic, sizeof(header->magic));
+		header->ready.store(1, std::memory_order_release);
+		return;
+	}
+
+	header = reinterpret_cast<Header*>(mapping);
+	if(!waitFor([this](){ return header->ready.load(std::memory_order_acquire) != 0; })
+			|| std::memcmp(header->magic, magic, sizeof(header->magic)) != 0
+			|| size != headerSize + std::size_t(header->slots)*header->slotSize) {
+		::munmap(mapping, size);
+		THROW Exception("Not a shared memory log ring: " + path);
+	}
+}
+
+Tial::Utility::Logger::Handlers::SharedRing::Segment::~Segment() {
+	::munmap(mapping, size);
+}
+
+Tial::Utility::Logger::Handlers::SharedRing::SharedRing(Level level, const std::string &name, std::size_t slots,
+		std::size_t slotSize): Handler(level), segment(std::make_unique<Segment>(name, slots, slotSize)) {}
+
+Tial::Utility::Logger::Handlers::SharedRing::~SharedRing() {}
+
+void Tial::Utility::Logger::Handlers::SharedRing::write(const Message &message) {
+	std::experimental::string_view module = truncated(message.site->module);
+	std::experimental::string_view file = truncated(message.site->file);
+	std::experimental::string_view function = truncated(message.site->function);
+	std::experimental::string_view thread = truncated(message.thread);
+	std::experimental::string_view text = message.stream.view();
+
+	std::size_t size = sizeof(SharedRecord) + module.size() + file.size() + function.size() + thread.size();
+	const std::size_t capacity = segment->payloadCapacity();
+	if(size > capacity) {
+		segment->header->dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	text = text.substr(0, capacity - size);
+	size += text.size();
+
+	Segment::Header &header = *segment->header;
+	const pid_t process = ::getpid();
+	uint64_t position = header.head.load(std::memory_order_relaxed);
+	for(;;) {
+		Segment::Slot &slot = segment->slot(position);
+		uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+		if(sequence & Segment::abandoned) {
+			if(segment->reclaim(slot, sequence))
+				continue;
+			// its writer is still busy with it, so the ring is full up to there
+			header.dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		int64_t difference = static_cast<int64_t>(sequence - position);
+		if(difference == 0) {
+			if(header.head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				break;
+		} else if(difference < 0) {
+			header.dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		} else {
+			position = header.head.load(std::memory_order_relaxed);
+		}
+	}
+
+	Segment::Slot &slot = segment->slot(position);
+	slot.process.store(process, std::memory_order_relaxed);
+	slot.claimed.store(position, std::memory_order_release);
+
+	SharedRecord record;
+	record.time = std::chrono::duration_cast<std::chrono::microseconds>(message.time.time_since_epoch()).count();
+	record.line = message.site->line;
+	record.process = process;
+	record.level = message.level;
+	record.reserved = 0;
+	record.module = module.size();
+	record.file = file.size();
+	record.function = function.size();
+	record.thread = thread.size();
+	record.text = text.size();
+
+	char *output = Segment::payload(slot);
+	std::memcpy(output, &record, sizeof(record));
+	output += sizeof(record);
+	for(auto &&string: {module, file, function, thread, text}) {
+		std::memcpy(output, string.data(), string.size());
+		output += string.size();
+	}
+	slot.size = size;
+	// fails only if the collector gave up waiting for this slot and marked it abandoned; it has moved on
+	// and counted the message as dropped, and nobody else writes the slot until it is freed here
+	uint64_t expected = position;
+	if(!slot.sequence.compare_exchange_strong(expected, position + 1, std::memory_order_release,
+			std::memory_order_relaxed))
+		slot.sequence.store(position + header.slots, std::memory_order_release);
+}
+
+uint64_t Tial::Utility::Logger::Handlers::SharedRing::dropped() const {
+	return segment->header->dropped.load(std::memory_order_relaxed);
+}
+
+void Tial::Utility::Logger::Handlers::SharedRing::remove(const std::string &name) {
+	::shm_unlink(Segment::path(name).c_str());
+}
+
+class Tial::Utility::Logger::Handlers::SharedRing::Collector::State {
+public:
+	Segment segment;
+	// call sites of collected messages, by module, file, function and line
+	std::map<std::string, std::unique_ptr<BinarySite>> sites;
+	uint64_t stalledPosition = std::numeric_limits<uint64_t>::max();
+	std::chrono::steady_clock::time_point stalledSince;
+
+	State(const std::string &name, std::size_t slots, std::size_t slotSize): segment(name, slots, slotSize) {}
+
+	const Site &site(const std::string &module, const std::string &file, const std::string &function, uint32_t line) {
+		std::string key = module + '\0' + file + '\0' + function + '\0' + std::to_string(line);
+		std::unique_ptr<BinarySite> &site = sites[key];
+		if(!site) {
+			site = std::make_unique<BinarySite>();
+			site->file = file;
+			site->function = function;
+			site->module = module;
+			site->site.file = site->file;
+			site->site.line = line;
+			site->site.function = site->function;
+			site->site.prettyFunction = site->function;
+			site->site.module = site->module;
+		}
+		return site->site;
+	}
+};
+
+Tial::Utility::Logger::Handlers::SharedRing::Collector::Collector(const std::string &name, std::size_t slots,
+		std::size_t slotSize): state(std::make_unique<State>(name, slots, slotSize)) {}
+
+Tial::Utility::Logger::Handlers::SharedRing::Collector::~Collector() {}
+
+std::size_t Tial::Utility::Logger::Handlers::SharedRing::Collector::drain(Handler &handler, std::size_t limit) {
+	Segment &segment = state->segment;
+	Segment::Header &header = *segment.header;
+	std::deque<Message> messages;
+	uint64_t position = header.tail.load(std::memory_order_relaxed);
+	while(messages.size() < limit) {
+		Segment::Slot &slot = segment.slot(position);
+		uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+		if(sequence != position + 1) {
+			if(sequence != position || header.head.load(std::memory_order_relaxed) <= position)
+				break;
+			// claimed but not committed yet
+			auto now = std::chrono::steady_clock::now();
+			if(state->stalledPosition != position) {
+				state->stalledPosition = position;
+				state->stalledSince = now;
+				break;
+			}
+			if(now - state->stalledSince < 1s)
+				break;
+			// its writer may still be filling it, so it is left for that writer to free
+			uint64_t expected = position;
+			if(slot.sequence.compare_exchange_strong(expected, position | Segment::abandoned)) {
+				header.dropped.fetch_add(1, std::memory_order_relaxed);
+				++position;
+			}
+			continue;
+		}
+
+		SharedRecord record;
+		const char *input = Segment::payload(slot);
+		std::memcpy(&record, input, sizeof(record));
+		input += sizeof(record);
+		std::size_t size = sizeof(record) + std::size_t(record.module) + record.file + record.function + record.thread
+			+ record.text;
+		if(size == slot.size && size <= segment.payloadCapacity()) {
+			auto string = [&input](std::size_t size) {
+				std::string result(input, size);
+				input += size;
+				return result;
+			};
+			std::string module = string(record.module);
+			std::string file = string(record.file);
+			std::string function = string(record.function);
+			std::string thread = string(record.thread);
+
+			Message pending(state->site(module, file, function, record.line), record.level,
+				Message::TimePoint(std::chrono::duration_cast<Message::TimePoint::duration>(std::chrono::microseconds(record.time))));
+			messages.emplace_back(std::move(pending));
+			Message &message = messages.back();
+			message.thread = std::to_string(record.process) + "/" + thread;
+			message.out().append(input, record.text);
+		} else {
+			header.dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+		slot.sequence.store(position + header.slots, std::memory_order_release);
+		++position;
+	}
+	header.tail.store(position, std::memory_order_relaxed);
+
+	if(!messages.empty()) {
+		std::vector<const Message*> batch;
+		batch.reserve(messages.size());
+		for(auto &&message: messages)
+			batch.push_back(&message);
+		handler.log(batch);
+	}
+	return messages.size();
+}
+
+uint64_t Tial::Utility::Logger::Handlers::SharedRing::Collector::dropped() const {
+	return state->segment.header->dropped.load(std::memory_order_relaxed);
 }
@@ -0,0 +1,254 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "Metrics.hpp"
+#include "Exception.hpp"
+#include "Thread.hpp"
+#include "Time.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#define TIAL_MODULE "Tial::Utility::Metrics"
+
+namespace {
+
+// never destroyed: metrics may unregister from destructors of static objects of other libraries
+struct Registry {
+	std::mutex mutex;
+	std::vector<const Tial::Utility::Metrics::Metric*> metrics;
+};
+
+Registry &registry() {
+	static Registry *registry = new Registry;
+	return *registry;
+}
+
+std::atomic<unsigned int> nextShard{0};
+
+bool inModule(const std::string &module, const std::string &prefix) {
+	return prefix.empty() || (module.compare(0, prefix.size(), prefix) == 0
+		&& (module.size() == prefix.size() || module.compare(prefix.size(), 2, "::") == 0));
+}
+
+}
+
+unsigned int Tial::Utility::Metrics::_nextShard() {
+	return nextShard++;
+}
+
+uint64_t Tial::Utility::Metrics::Distribution::percentile(double fraction) const {
+	if(count == 0)
+		return 0;
+	uint64_t rank = static_cast<uint64_t>(std::ceil(fraction*count));
+	uint64_t seen = 0;
+	for(std::size_t i = 0; i < bucketCount; ++i) {
+		seen += buckets[i];
+		if(seen >= rank && seen > 0)
+			return i == 0 ? 0 : i == 64 ? UINT64_MAX : (uint64_t(1) << i) - 1;
+	}
+	return UINT64_MAX;
+}
+
+Tial::Utility::Metrics::Metric::Metric(const std::string &module, const std::string &name, Kind kind):
+	module_(module), name_(name), kind_(kind) {}
+
+Tial::Utility::Metrics::Metric::~Metric() = default;
+
+void Tial::Utility::Metrics::Metric::registerMetric() {
+	Registry &r = registry();
+	std::unique_lock<std::mutex> lock(r.mutex);
+	r.metrics.push_back(this);
+}
+
+// waits for a snapshot sampling this metric to finish
+void Tial::Utility::Metrics::Metric::unregisterMetric() {
+	Registry &r = registry();
+	std::unique_lock<std::mutex> lock(r.mutex);
+	r.metrics.erase(std::remove(r.metrics.begin(), r.metrics.end(), this), r.metrics.end());
+}
+
+Tial::Utility::Metrics::Counter::Counter(const std::string &module, const std::string &name):
+		Metric(module, name, Kind::Counter) {
+	registerMetric();
+}
+
+Tial::Utility::Metrics::Counter::~Counter() {
+	unregisterMetric();
+}
+
+uint64_t Tial::Utility::Metrics::Counter::value() const {
+	uint64_t total = 0;
+	for(auto &&shard: shards)
+		total += shard.value.load(std::memory_order_relaxed);
+	return total;
+}
+
+Tial::Utility::Metrics::Sample Tial::Utility::Metrics::Counter::sample() const {
+	Sample sample{module(), name(), kind(), static_cast<int64_t>(value()), {}};
+	return sample;
+}
+
+Tial::Utility::Metrics::Gauge::Gauge(const std::string &module, const std::string &name):
+		Metric(module, name, Kind::Gauge) {
+	registerMetric();
+}
+
+Tial::Utility::Metrics::Gauge::~Gauge() {
+	unregisterMetric();
+}
+
+Tial::Utility::Metrics::Sample Tial::Utility::Metrics::Gauge::sample() const {
+	Sample sample{module(), name(), kind(), value(), {}};
+	return sample;
+}
+
+Tial::Utility::Metrics::Histogram::Histogram(const std::string &module, const std::string &name):
+		Metric(module, name, Kind::Histogram) {
+	registerMetric();
+}
+
+Tial::Utility::Metrics::Histogram::~Histogram() {
+	unregisterMetric();
+}
+
+// Shards are read one counter at a time while other threads record, so a snapshot may include a value
+// in sum but not yet in its bucket; the difference is at most the values of concurrent records.
+Tial::Utility::Metrics::Distribution Tial::Utility::Metrics::Histogram::distribution() const {
+	Distribution distribution;
+	for(auto &&shard: shards) {
+		distribution.sum += shard.sum.load(std::memory_order_relaxed);
+		for(std::size_t i = 0; i < Distribution::bucketCount; ++i) {
+			uint64_t count = shard.buckets[i].load(std::memory_order_relaxed);
+			distribution.buckets[i] += count;
+			distribution.count += count;
+		}
+	}
+	return distribution;
+}
+
+Tial::Utility::Metrics::Sample Tial::Utility::Metrics::Histogram::sample() const {
+	Sample sample{module(), name(), kind(), 0, distribution()};
+	sample.value = static_cast<int64_t>(sample.distribution.count);
+	return sample;
+}
+
+std::vector<Tial::Utility::Metrics::Sample> Tial::Utility::Metrics::snapshot(const std::string &module) {
+	std::vector<Sample> samples;
+	{
+		Registry &r = registry();
+		std::unique_lock<std::mutex> lock(r.mutex);
+		for(auto &&metric: r.metrics)
+			if(inModule(metric->module(), module))
+				samples.push_back(metric->sample());
+	}
+	std::sort(samples.begin(), samples.end(), [](const Sample &a, const Sample &b) {
+		return a.module != b.module ? a.module < b.module : a.name < b.name;
+	});
+	return samples;
+}
+
+std::string Tial::Utility::Metrics::format(const Sample &sample) {
+	std::ostringstream stream;
+	stream << sample.module << ' ' << sample.name;
+	if(sample.kind == Kind::Histogram)
+		stream << " count=" << sample.distribution.count << " sum=" << sample.distribution.sum
+			<< " p50=" << sample.distribution.percentile(0.5) << " p90=" << sample.distribution.percentile(0.9)
+			<< " p99=" << sample.distribution.percentile(0.99);
+	else
+		stream << ' ' << sample.value;
+	return stream.str();
+}
+
+Tial::Utility::Metrics::Reporter::Reporter(std::chrono::milliseconds interval, Output output,
+		const std::string &module): module(module), output(std::move(output)), interval(interval),
+		thread(&Reporter::run, this) {}
+
+Tial::Utility::Metrics::Reporter::Reporter(std::chrono::milliseconds interval,
+		std::unique_ptr<Logger::Handler> &&handler, const std::string &module):
+		Reporter(interval, [handler = std::shared_ptr<Logger::Handler>(std::move(handler))](
+				const std::vector<Sample> &samples) {
+			static const Logger::Site site{
+				__FILE__, __LINE__, __FUNCTION__, TIAL_UTILITY_LANGUAGE_FUNCTION_SIGNATURE, TIAL_UTILITY_LANGUAGE_CURRENT_MODULE
+			};
+			auto time = std::chrono::system_clock::now();
+			for(auto &&sample: samples) {
+				Logger::Message message(site, Logger::Level::Info, time);
+				message.out() << format(sample).c_str();
+				message.out().kv("module", sample.module).kv("metric", sample.name);
+				if(sample.kind == Kind::Histogram)
+					message.out().kv("count", sample.distribution.count).kv("sum", sample.distribution.sum)
+						.kv("p50", sample.distribution.percentile(0.5)).kv("p90", sample.distribution.percentile(0.9))
+						.kv("p99", sample.distribution.percentile(0.99));
+				else
+					message.out().kv("value", sample.value);
+				// detached: reaches this handler only
+				Logger::Message detached(std::move(message));
+				handler->log(detached);
+			}
+			handler->flush();
+		}, module) {}
+
+Tial::Utility::Metrics::Reporter::Reporter(std::chrono::milliseconds interval, const std::string &fileName,
+		const std::string &module):
+		Reporter(interval, [fileName](const std::vector<Sample> &samples) {
+			std::ofstream file(fileName, std::ios::app);
+			if(!file)
+				THROW Exception("Cannot open metrics file " + fileName);
+			std::string time = Time::formatTimestamp(std::chrono::system_clock::now());
+			for(auto &&sample: samples)
+				file << time << ' ' << format(sample) << '\n';
+		}, module) {}
+
+Tial::Utility::Metrics::Reporter::~Reporter() {
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeUp.notify_one();
+	thread.join();
+	try {
+		report();
+	} catch(const std::exception &e) {
+		LOGW << "Metrics report failed: " << e.what();
+	}
+}
+
+void Tial::Utility::Metrics::Reporter::report() {
+	output(snapshot(module));
+}
+
+void Tial::Utility::Metrics::Reporter::run() {
+	Thread::setName("metrics reporter");
+	std::unique_lock<std::mutex> lock(mutex);
+	while(!wakeUp.wait_for(lock, interval, [this](){ return stopping; })) {
+		lock.unlock();
+		try {
+			report();
+		} catch(const std::exception &e) {
+			LOGW << "Metrics report failed: " << e.what();
+		}
+		lock.lock();
+	}
+}
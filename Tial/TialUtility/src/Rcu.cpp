@@ -0,0 +1,101 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "Rcu.hpp"
+
+#include <thread>
+
+#define TIAL_MODULE "Tial::Utility::Rcu"
+
+namespace {
+
+// One per thread that ever entered a read section. Records are never freed; a record released by an exited
+// thread is reused by the next new one.
+struct Reader {
+	std::atomic<uint64_t> epoch{0};
+	std::atomic<bool> owned{true};
+	Reader *next = nullptr;
+	unsigned int nesting = 0;
+};
+
+std::atomic<Reader*> readers{nullptr};
+std::atomic<uint64_t> globalEpoch{1};
+
+Reader *acquireReader() {
+	for(Reader *reader = readers.load(); reader; reader = reader->next) {
+		bool owned = false;
+		if(!reader->owned.load() && reader->owned.compare_exchange_strong(owned, true))
+			return reader;
+	}
+	Reader *reader = new Reader;
+	reader->next = readers.load();
+	while(!readers.compare_exchange_weak(reader->next, reader));
+	return reader;
+}
+
+thread_local Reader *threadReader = nullptr;
+
+thread_local struct ReaderRelease {
+	~ReaderRelease() {
+		if(threadReader) {
+			threadReader->owned.store(false);
+			threadReader = nullptr;
+		}
+	}
+} readerRelease;
+
+Reader &currentReader() {
+	if(!threadReader) {
+		threadReader = acquireReader();
+		(void)&readerRelease;
+	}
+	return *threadReader;
+}
+
+}
+
+Tial::Utility::Rcu::ReadSection::ReadSection() {
+	Reader &reader = currentReader();
+	if(reader.nesting++ == 0) {
+		reader.epoch.store(globalEpoch.load());
+		// the epoch must be visible to synchronize() before any shared pointer is loaded
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+	}
+}
+
+Tial::Utility::Rcu::ReadSection::~ReadSection() {
+	Reader &reader = *threadReader;
+	if(--reader.nesting == 0)
+		reader.epoch.store(0, std::memory_order_release);
+}
+
+void Tial::Utility::Rcu::synchronize() {
+	uint64_t epoch = ++globalEpoch;
+	for(Reader *reader = readers.load(); reader; reader = reader->next) {
+		for(;;) {
+			uint64_t readerEpoch = reader->epoch.load();
+			if(readerEpoch == 0 || readerEpoch >= epoch)
+				break;
+			std::this_thread::yield();
+		}
+	}
+}
@@ -31,17 +31,23 @@
 #define TIAL_MODULE "Tial::Utility::Thread"
 
 static thread_local std::string currentThreadName = boost::lexical_cast<std::string>(std::this_thread::get_id());
+static thread_local unsigned int currentThreadNameChanges = 0;
 
 Tial::Utility::Thread::Exceptions::InvalidHandle::InvalidHandle(): Exception("invalid handle") {}
 
 void Tial::Utility::Thread::setName(const std::string &name) {
 	currentThreadName = name;
+	++currentThreadNameChanges;
 }
 
 std::string Tial::Utility::Thread::name() {
 	return currentThreadName;
 }
 
+unsigned int Tial::Utility::Thread::_nameChanges() {
+	return currentThreadNameChanges;
+}
+
 void Tial::Utility::Thread::kill(const std::thread::native_handle_type &handle) {
 #if (BOOST_OS_UNIX || BOOST_OS_MACOS)
 	if(handle == std::thread::native_handle_type())
@@ -0,0 +1,117 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "Time.hpp"
+
+#include <cstring>
+
+#define TIAL_MODULE "Tial::Utility::Time"
+
+namespace {
+
+const char digitPairs[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+char *appendPair(char *output, int value) {
+	std::memcpy(output, &digitPairs[2*value], 2);
+	return output + 2;
+}
+
+// "YYYY-MM-DDTHH:MM:SS." of the last formatted second
+struct Prefix {
+	bool valid;
+	std::time_t second;
+	std::size_t length;
+	char text[Tial::Utility::Time::maxTimestampLength];
+};
+
+thread_local Prefix localPrefix;
+thread_local Prefix utcPrefix;
+
+void updatePrefix(Prefix &prefix, std::time_t second, Tial::Utility::Time::Zone zone) {
+	std::tm tm;
+	switch(zone) {
+	case Tial::Utility::Time::Zone::Local:
+		localtime_r(&second, &tm);
+		break;
+	case Tial::Utility::Time::Zone::UTC:
+		gmtime_r(&second, &tm);
+		break;
+	default:
+		THROW Tial::Utility::Exception("Invalid time zone argument");
+	}
+
+	// system_clock spans a few centuries around 1970, so years always have four digits
+	char *output = prefix.text;
+	int year = tm.tm_year + 1900;
+	output = appendPair(output, year / 100);
+	output = appendPair(output, year % 100);
+	*output++ = '-';
+	output = appendPair(output, tm.tm_mon + 1);
+	*output++ = '-';
+	output = appendPair(output, tm.tm_mday);
+	*output++ = 'T';
+	output = appendPair(output, tm.tm_hour);
+	*output++ = ':';
+	output = appendPair(output, tm.tm_min);
+	*output++ = ':';
+	output = appendPair(output, tm.tm_sec);
+	*output++ = '.';
+
+	prefix.valid = true;
+	prefix.second = second;
+	prefix.length = output - prefix.text;
+}
+
+}
+
+std::size_t Tial::Utility::Time::formatTimestamp(const std::chrono::system_clock::time_point &time, char *output,
+		Zone zone) {
+	std::time_t second = std::chrono::system_clock::to_time_t(time);
+	Prefix &prefix = zone == Zone::UTC ? utcPrefix : localPrefix;
+	if(!prefix.valid || prefix.second != second)
+		updatePrefix(prefix, second, zone);
+	std::memcpy(output, prefix.text, prefix.length);
+
+	int microseconds = static_cast<int>(
+		std::abs(std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count()) % 1000000
+	);
+	char *suffix = output + prefix.length;
+	suffix = appendPair(suffix, microseconds / 10000);
+	suffix = appendPair(suffix, microseconds / 100 % 100);
+	suffix = appendPair(suffix, microseconds % 100);
+	return suffix - output;
+}
+
+std::string Tial::Utility::Time::formatTimestamp(const std::chrono::system_clock::time_point &time, Zone zone) {
+	char output[maxTimestampLength];
+	return std::string(output, formatTimestamp(time, output, zone));
+}
@@ -0,0 +1,225 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "Trace.hpp"
+#include "Exception.hpp"
+#include "Thread.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+#include <unistd.h>
+
+#define TIAL_MODULE "Tial::Utility::Trace"
+
+std::atomic<bool> Tial::Utility::Trace::_recording{false};
+
+namespace {
+
+constexpr std::size_t chunkEvents = 1024;
+
+// Filled only by the owning thread; size is published after each event and next once the chunk is full, so the
+// collector may read completed events at any time.
+struct Chunk {
+	Tial::Utility::Trace::Event events[chunkEvents];
+	std::atomic<std::size_t> size{0};
+	std::atomic<Chunk*> next{nullptr};
+};
+
+struct Buffer {
+	// copy of the owner's name, refreshed by the owner on its first event after a change
+	std::mutex threadMutex;
+	std::string thread;
+	unsigned int threadChanges;
+	unsigned int threadId;
+	// owner only
+	Chunk *tail;
+	// collector only: oldest chunk and the number of its events already collected
+	Chunk *head;
+	std::size_t collected = 0;
+	// set when the owning thread exits; the collector then frees the buffer once drained
+	std::atomic<bool> finished{false};
+
+	Buffer(unsigned int threadId): thread(Tial::Utility::Thread::name()),
+		threadChanges(Tial::Utility::Thread::_nameChanges()), threadId(threadId), tail(new Chunk), head(tail) {}
+};
+
+std::mutex buffersMutex;
+std::vector<Buffer*> buffers;
+unsigned int nextThreadId = 1;
+
+thread_local Buffer *threadBuffer = nullptr;
+
+thread_local struct BufferRelease {
+	~BufferRelease() {
+		if(threadBuffer) {
+			threadBuffer->finished.store(true, std::memory_order_release);
+			threadBuffer = nullptr;
+		}
+	}
+} bufferRelease;
+
+Buffer &currentBuffer() {
+	if(!threadBuffer) {
+		std::unique_lock<std::mutex> lock(buffersMutex);
+		threadBuffer = new Buffer(nextThreadId++);
+		buffers.push_back(threadBuffer);
+		(void)&bufferRelease;
+	}
+	return *threadBuffer;
+}
+
+std::size_t drain(Buffer &buffer, const std::function<void(const std::string&, unsigned int,
+		const Tial::Utility::Trace::Event&)> &function) {
+	std::string thread;
+	{
+		std::unique_lock<std::mutex> lock(buffer.threadMutex);
+		thread = buffer.thread;
+	}
+	std::size_t count = 0;
+	for(;;) {
+		Chunk *chunk = buffer.head;
+		// once next is set, the chunk is complete
+		Chunk *next = chunk->next.load(std::memory_order_acquire);
+		std::size_t size = chunk->size.load(std::memory_order_acquire);
+		for(; buffer.collected < size; ++buffer.collected, ++count)
+			function(thread, buffer.threadId, chunk->events[buffer.collected]);
+		if(!next)
+			return count;
+		delete chunk;
+		buffer.head = next;
+		buffer.collected = 0;
+	}
+}
+
+void writeJsonString(std::ostream &stream, const char *s) {
+	static const char hex[] = "0123456789abcdef";
+	stream << '"';
+	for(; *s; ++s) {
+		unsigned char c = *s;
+		if(c == '"' || c == '\\')
+			stream << '\\' << *s;
+		else if(c < 0x20)
+			stream << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+		else
+			stream << *s;
+	}
+	stream << '"';
+}
+
+}
+
+void Tial::Utility::Trace::start() {
+	_recording.store(true);
+}
+
+void Tial::Utility::Trace::stop() {
+	_recording.store(false);
+}
+
+void Tial::Utility::Trace::_record(const char *name, Phase phase, int64_t value) {
+	int64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+	Buffer &buffer = currentBuffer();
+	unsigned int changes = Tial::Utility::Thread::_nameChanges();
+	if(changes != buffer.threadChanges) {
+		std::unique_lock<std::mutex> lock(buffer.threadMutex);
+		buffer.thread = Tial::Utility::Thread::name();
+		buffer.threadChanges = changes;
+	}
+	Chunk *chunk = buffer.tail;
+	std::size_t size = chunk->size.load(std::memory_order_relaxed);
+	if(size == chunkEvents) {
+		Chunk *next = new Chunk;
+		chunk->next.store(next, std::memory_order_release);
+		buffer.tail = chunk = next;
+		size = 0;
+	}
+	Event &event = chunk->events[size];
+	event.name = name;
+	event.value = value;
+	event.time = time;
+	event.phase = phase;
+	chunk->size.store(size + 1, std::memory_order_release);
+}
+
+std::size_t Tial::Utility::Trace::collect(const std::function<void(const std::string &thread, unsigned int threadId,
+		const Event &event)> &function) {
+	std::unique_lock<std::mutex> lock(buffersMutex);
+	std::size_t count = 0;
+	for(auto i = buffers.begin(); i != buffers.end();) {
+		Buffer *buffer = *i;
+		// read before draining: events recorded before the thread exited are then all visible
+		bool finished = buffer->finished.load(std::memory_order_acquire);
+		count += drain(*buffer, function);
+		if(finished) {
+			delete buffer->head;
+			delete buffer;
+			i = buffers.erase(i);
+		} else {
+			++i;
+		}
+	}
+	return count;
+}
+
+void Tial::Utility::Trace::writeChromeTrace(std::ostream &stream) {
+	const auto pid = ::getpid();
+	std::vector<unsigned int> named;
+	bool first = true;
+	stream << "{\"traceEvents\":[";
+	collect([&](const std::string &thread, unsigned int threadId, const Event &event) {
+		if(std::find(named.begin(), named.end(), threadId) == named.end()) {
+			named.push_back(threadId);
+			stream << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+				<< ",\"tid\":" << threadId << ",\"args\":{\"name\":";
+			writeJsonString(stream, thread.c_str());
+			stream << "}}";
+			first = false;
+		}
+		static const char phases[] = {'B', 'E', 'C'};
+		stream << (first ? "\n" : ",\n") << "{\"name\":";
+		writeJsonString(stream, event.name);
+		// microseconds with nanosecond precision, formatted apart so that the fill of the stream stays untouched
+		char time[32];
+		std::snprintf(time, sizeof(time), "%lld.%03d", static_cast<long long>(event.time/1000),
+			static_cast<int>(event.time%1000));
+		stream << ",\"ph\":\"" << phases[static_cast<int>(event.phase)] << "\",\"ts\":" << time
+			<< ",\"pid\":" << pid << ",\"tid\":" << threadId;
+		if(event.phase == Phase::Counter)
+			stream << ",\"args\":{\"value\":" << event.value << "}";
+		stream << "}";
+		first = false;
+	});
+	stream << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+void Tial::Utility::Trace::writeChromeTrace(const std::string &fileName) {
+	std::ofstream stream(fileName);
+	if(!stream)
+		THROW Exception("Cannot open trace file " + fileName);
+	writeChromeTrace(stream);
+}
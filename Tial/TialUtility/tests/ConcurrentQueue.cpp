@@ -0,0 +1,105 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <TialTesting/TialTesting.hpp>
+#include <TialUtility/TialUtility.hpp>
+
+#include <algorithm>
+#include <atomic>
+
+#define TIAL_MODULE "Tial::Utility::ConcurrentQueue/Test"
+
+[[Tial::Testing::Typedef]] namespace Testing = Tial::Testing;
+[[Tial::Testing::Typedef]] namespace Check = Tial::Testing::Check;
+
+namespace [[Testing::Suite]] Tial {
+namespace [[Testing::Suite]] Utility {
+namespace [[Testing::Suite]] TestConcurrentQueue {
+
+class [[Testing::Case]] SingleThread {
+	void operator()() {
+		Tial::Utility::ConcurrentQueue<int> queue(3);
+		[[Check::Verify]] queue.capacity() == 4u;
+		[[Check::Verify]] queue.empty();
+
+		for(int i = 0; i < 4; ++i)
+			[[Check::Verify]] queue.push(std::move(i));
+		int overflow = 4;
+		[[Check::Verify]] !queue.push(std::move(overflow));
+
+		int value = -1;
+		for(int i = 0; i < 4; ++i) {
+			[[Check::Verify]] queue.pop(value);
+			[[Check::Verify]] value == i;
+		}
+		[[Check::Verify]] !queue.pop(value);
+		[[Check::Verify]] queue.empty();
+	}
+};
+
+class [[Testing::Case]] MultipleProducers {
+	static constexpr int producers = 4;
+	static constexpr int count = 10000;
+
+	void operator()() {
+		Tial::Utility::ConcurrentQueue<int> queue(64);
+		std::atomic<int> nextProducer{0};
+
+		Testing::Thread producer([&](){
+			int id = nextProducer++;
+			for(int i = 0; i < count; ++i) {
+				int value = id*count + i;
+				while(!queue.push(std::move(value)))
+					std::this_thread::yield();
+			}
+		});
+		std::vector<Testing::Thread> threads(producers, producer);
+		for(int i = 0; i < producers; ++i)
+			threads[i]("producer");
+
+		std::vector<int> last(producers, -1);
+		bool ordered = true;
+		int received = 0;
+		while(received < producers*count) {
+			int value;
+			if(!queue.pop(value)) {
+				std::this_thread::yield();
+				continue;
+			}
+			int id = value / count;
+			ordered = ordered && (value % count) > last[id];
+			last[id] = value % count;
+			++received;
+		}
+		for(auto &&thread: threads)
+			thread.join();
+
+		bool complete = std::all_of(last.begin(), last.end(), [](int i){ return i == count-1; });
+		[[Check::Verify]] ordered;
+		[[Check::Verify]] complete;
+		[[Check::Verify]] queue.empty();
+	}
+};
+
+}
+}
+}
@@ -0,0 +1,1454 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <TialTesting/TialTesting.hpp>
+#include <TialUtility/TialUtility.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <mutex>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define TIAL_MODULE "Tial::Utility::Logger/Test"
+
+// Replaces the global allocation functions of the whole test executable, not only of MetadataAllocations;
+// the counter is only compared within that test's measured region, so no other test may rely on it.
+static thread_local std::size_t allocations = 0;
+
+void *operator new(std::size_t size) {
+	++allocations;
+	if(void *pointer = std::malloc(size ? size : 1))
+		return pointer;
+	throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+	std::free(pointer);
+}
+
+[[Tial::Testing::Typedef]] namespace Testing = Tial::Testing;
+[[Tial::Testing::Typedef]] namespace Check = Tial::Testing::Check;
+
+namespace [[Testing::Suite]] Tial {
+namespace [[Testing::Suite]] Utility {
+namespace [[Testing::Suite]] Logger {
+
+struct Captured {
+	std::string thread;
+	std::string output;
+	const Tial::Utility::Logger::Site *site;
+};
+
+class Capture: public Tial::Utility::Logger::Handler {
+	std::mutex mutex;
+	std::vector<Captured> messages;
+public:
+	Capture(): Handler(Tial::Utility::Logger::Level::Nice3) {}
+
+	virtual void write(const Tial::Utility::Logger::Message &message) override {
+		if(message.site->module != TIAL_MODULE)
+			return;
+		std::unique_lock<std::mutex> lock(mutex);
+		messages.push_back({message.thread, message.stream.output(), message.site});
+	}
+
+	std::vector<Captured> take() {
+		std::unique_lock<std::mutex> lock(mutex);
+		return std::move(messages);
+	}
+
+	static Capture &instance() {
+		static Capture *capture = [](){
+			auto handler = std::make_unique<Capture>();
+			Capture *result = handler.get();
+			Tial::Utility::Logger::addHandler(std::move(handler));
+			return result;
+		}();
+		return *capture;
+	}
+};
+
+// keeps the text of every message it is given
+class Collect: public Tial::Utility::Logger::Handler {
+public:
+	std::vector<std::string> &lines;
+	std::vector<std::string> threads;
+	std::size_t batches = 0;
+
+	explicit Collect(std::vector<std::string> &lines): Handler(Tial::Utility::Logger::Level::Nice3), lines(lines) {}
+
+	virtual void write(const Tial::Utility::Logger::Message &message) override {
+		lines.push_back(message.stream.output());
+		threads.push_back(message.thread);
+	}
+
+	virtual void writeBatch(const std::vector<const Tial::Utility::Logger::Message*> &messages) override {
+		++batches;
+		Handler::writeBatch(messages);
+	}
+};
+
+// counts messages of each level; may be called from several threads at once
+class Count: public Tial::Utility::Logger::Handler {
+public:
+	std::atomic<int> warnings{0};
+	std::atomic<int> infos{0};
+
+	Count(): Handler(Tial::Utility::Logger::Level::Nice3) {}
+
+	virtual void write(const Tial::Utility::Logger::Message &message) override {
+		if(message.level == Tial::Utility::Logger::Level::Warning)
+			++warnings;
+		else
+			++infos;
+	}
+};
+
+// keeps the asynchronous writer inside write() until released
+class Gate: public Tial::Utility::Logger::Handler {
+	std::mutex mutex;
+	std::condition_variable changed;
+	bool entered = false;
+	bool released = false;
+
+public:
+	std::vector<std::string> &lines;
+
+	explicit Gate(std::vector<std::string> &lines): Handler(Tial::Utility::Logger::Level::Nice3), lines(lines) {}
+
+	virtual void write(const Tial::Utility::Logger::Message &message) override {
+		std::unique_lock<std::mutex> lock(mutex);
+		entered = true;
+		changed.notify_all();
+		changed.wait(lock, [this](){ return released; });
+		lines.push_back(message.stream.output());
+	}
+
+	void waitEntered() {
+		std::unique_lock<std::mutex> lock(mutex);
+		changed.wait(lock, [this](){ return entered; });
+	}
+
+	void release() {
+		std::unique_lock<std::mutex> lock(mutex);
+		released = true;
+		changed.notify_all();
+	}
+};
+
+Tial::Utility::Logger::Message record(const std::string &text, Tial::Utility::Logger::Level level) {
+	static const Tial::Utility::Logger::Site site{
+		__FILE__, __LINE__, __FUNCTION__, TIAL_UTILITY_LANGUAGE_FUNCTION_SIGNATURE, TIAL_UTILITY_LANGUAGE_CURRENT_MODULE
+	};
+	Tial::Utility::Logger::Message message(site, level, std::chrono::system_clock::now());
+	message.out() << text.c_str();
+	return Tial::Utility::Logger::Message(std::move(message));
+}
+
+std::vector<std::string> readLines(const std::string &fileName) {
+	std::vector<std::string> lines;
+	std::ifstream file(fileName);
+	std::string line;
+	while(std::getline(file, line))
+		lines.push_back(line);
+	return lines;
+}
+
+std::vector<std::string> filesWithPrefix(const std::string &prefix) {
+	std::vector<std::string> result;
+	for(auto &&entry: Tial::Utility::NativeDirectory::current().content()) {
+		std::string name(entry->path().basename());
+		if(name.compare(0, prefix.size(), prefix) == 0)
+			result.push_back(name);
+	}
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+void removeFiles(const std::vector<std::string> &names) {
+	for(auto &&name: names)
+		std::remove(name.c_str());
+}
+
+class [[Testing::Case]] Synchronous {
+	void operator()() {
+		Capture &capture = Capture::instance();
+		capture.take();
+
+		LOGI << "first";
+		LOGD << "second";
+		auto messages = capture.take();
+		[[Check::Verify]] messages.size() == 2u;
+		[[Check::Verify]] messages[0].output == "first";
+		[[Check::Verify]] messages[1].output == "second";
+	}
+};
+
+class [[Testing::Case]] StreamFormatting {
+	void operator()() {
+		Tial::Utility::Logger::Stream stream;
+		stream << "int " << -42 << " " << std::numeric_limits<long long>::min() << " "
+			<< std::numeric_limits<unsigned long long>::max() << " " << 0u << " " << true << " "
+			<< reinterpret_cast<const void*>(0x1f) << " " << std::string("quoted");
+		const std::string expected = "int -42 -9223372036854775808 18446744073709551615 0 true @0x1f \"quoted\"";
+		[[Check::Verify]] stream.view() == expected;
+		[[Check::Verify]] stream.output() == stream.view().to_string();
+	}
+};
+
+class [[Testing::Case]] StreamStorage {
+	void operator()() {
+		std::size_t before = allocations;
+		Tial::Utility::Logger::Stream stream;
+		stream << "message " << 123 << " " << false;
+		std::size_t after = allocations;
+		[[Check::Verify]] after == before;
+
+		Tial::Utility::Logger::Stream nested;
+		nested << "nested";
+		[[Check::Verify]] allocations > after;
+		[[Check::Verify]] nested.view() == "nested";
+
+		std::string large(3000, 'x');
+		stream << large.c_str();
+		[[Check::Verify]] stream.view().size() == 17u + large.size();
+
+		Tial::Utility::Logger::Stream moved(std::move(stream));
+		[[Check::Verify]] stream.view().empty();
+		[[Check::Verify]] moved.view().substr(0, 17) == "message 123 false";
+	}
+};
+
+class [[Testing::Case]] LayoutPattern {
+	void operator()() {
+		auto message = record("text\twith tab", Tial::Utility::Logger::Level::Warning);
+		message.thread = "thread";
+
+		std::string line;
+		Tial::Utility::Logger::Layout("%thread%|10[%level] %% %msg").format(message, line);
+		[[Check::Verify]] line == "thread    [WARNING ] % text\twith tab";
+
+		line.clear();
+		Tial::Utility::Logger::Layout("%level|%msg|%line", Tial::Utility::Logger::Layout::Values::Escaped).format(message, line);
+		std::string expected = "WARNING|text\\twith tab|" + std::to_string(message.site->line);
+		[[Check::Verify]] line == expected;
+
+		[[Check::Throw(Tial::Utility::Exception)]] Tial::Utility::Logger::Layout("%unknown");
+		[[Check::Throw(Tial::Utility::Exception)]] Tial::Utility::Logger::Layout("%|x");
+	}
+};
+
+class [[Testing::Case]] StructuredFields {
+	void operator()() {
+		Tial::Utility::Logger::Stream stream;
+		std::string path = "/tmp/a b";
+		stream.kv("latency_us", 123).kv("delta", -5).kv("ratio", 0.25).kv("ok", true).kv("path", path) << "done";
+		[[Check::Verify]] stream.output() == "done";
+
+		std::vector<std::string> keys;
+		std::vector<Tial::Utility::Logger::Fields::Type> types;
+		stream.fields.forEach([&](const Tial::Utility::Logger::Fields::Field &field) {
+			keys.push_back(field.key.to_string());
+			types.push_back(field.type);
+		});
+		std::vector<std::string> expectedKeys{"latency_us", "delta", "ratio", "ok", "path"};
+		[[Check::Verify]] keys == expectedKeys;
+		bool typed = types[0] == Tial::Utility::Logger::Fields::Type::Signed
+			&& types[2] == Tial::Utility::Logger::Fields::Type::Floating
+			&& types[3] == Tial::Utility::Logger::Fields::Type::Boolean
+			&& types[4] == Tial::Utility::Logger::Fields::Type::String;
+		[[Check::Verify]] typed;
+
+		auto message = record("done", Tial::Utility::Logger::Level::Info);
+		message.out().kv("count", 3u).kv("name", "x\ty");
+		std::string line;
+		Tial::Utility::Logger::Layout("%msg%fields", Tial::Utility::Logger::Layout::Values::Escaped).format(message, line);
+		std::string expectedLine = "done count=3 name=" "\"x\\ty\"";
+		[[Check::Verify]] line == expectedLine;
+	}
+};
+
+class [[Testing::Case]] LayoutSharedTime {
+	void operator()() {
+		auto message = record("text", Tial::Utility::Logger::Level::Info);
+		[[Check::Verify]] message.formattedTimeLength == 0u;
+
+		std::string console, file;
+		Tial::Utility::Logger::Layout("%time").format(message, console);
+		[[Check::Verify]] message.formattedTimeLength == console.size();
+		Tial::Utility::Logger::Layout("%time", Tial::Utility::Logger::Layout::Values::Escaped).format(message, file);
+		[[Check::Verify]] console == file;
+		[[Check::Verify]] console == Tial::Utility::Time::timeCast(message.time);
+	}
+};
+
+class [[Testing::Case]] StaticSite {
+	void operator()() {
+		Capture &capture = Capture::instance();
+		capture.take();
+
+		for(int i = 0; i < 3; ++i)
+			LOGD << "message " << i;
+		LOGD << "other";
+		auto messages = capture.take();
+		[[Check::Verify]] messages.size() == 4u;
+		[[Check::Verify]] messages[0].site == messages[2].site;
+		[[Check::Verify]] messages[2].site != messages[3].site;
+		bool nextLine = messages[3].site->line == messages[0].site->line + 1;
+		bool function = messages[0].site->function == "operator()";
+		[[Check::Verify]] nextLine;
+		[[Check::Verify]] function;
+	}
+};
+
+class [[Testing::Case]] CachedSiteLevel {
+	void log(int i) {
+		LOGD << "message " << i;
+	}
+
+	void operator()() {
+		Capture &capture = Capture::instance();
+		capture.take();
+
+		log(0);
+		Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Info, TIAL_MODULE);
+		log(1);
+		Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Nice3, TIAL_MODULE);
+		log(2);
+
+		auto messages = capture.take();
+		[[Check::Verify]] messages.size() == 2u;
+		[[Check::Verify]] messages[1].output == "message 2";
+	}
+};
+
+class [[Testing::Case]] ModuleLevels {
+	void operator()() {
+		Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Warning, "TestModuleLevels::A");
+		Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Nice1, "TestModuleLevels::A::B::C");
+
+		using Tial::Utility::Logger::Level;
+		using Tial::Utility::Logger::toBeLoggedRuntime;
+		[[Check::Verify]] toBeLoggedRuntime(Level::Warning, "TestModuleLevels::A");
+		[[Check::Verify]] !toBeLoggedRuntime(Level::Info, "TestModuleLevels::A");
+		[[Check::Verify]] !toBeLoggedRuntime(Level::Info, "TestModuleLevels::A::B");
+		[[Check::Verify]] toBeLoggedRuntime(Level::Nice1, "TestModuleLevels::A::B::C::D");
+		[[Check::Verify]] !toBeLoggedRuntime(Level::Nice2, "TestModuleLevels::A::B::C");
+		[[Check::Verify]] toBeLoggedRuntime(Level::Info, "TestModuleLevels::AB");
+	}
+};
+
+class [[Testing::Case]] ModuleCompileLevels {
+	void operator()() {
+		static constexpr Tial::Utility::Logger::ModuleCompileLevel table[] = {
+			{"Tial::Utility", 25},
+			{"Tial::Utility::Path", 50},
+			{nullptr, 0}
+		};
+		constexpr int path = Tial::Utility::Logger::compileLevel("Tial::Utility::Path", table, 10);
+		constexpr int nested = Tial::Utility::Logger::compileLevel("Tial::Utility::Path::Cache", table, 10);
+		constexpr int parent = Tial::Utility::Logger::compileLevel("Tial::Utility::Wildcards", table, 10);
+		constexpr int sibling = Tial::Utility::Logger::compileLevel("Tial::Utility::PathList", table, 10);
+		constexpr int unlisted = Tial::Utility::Logger::compileLevel("Other", table, 10);
+		[[Check::Verify]] path == 50;
+		[[Check::Verify]] nested == 50;
+		[[Check::Verify]] parent == 25;
+		[[Check::Verify]] sibling == 25;
+		[[Check::Verify]] unlisted == 10;
+
+		constexpr bool disabled = !Tial::Utility::Logger::toBeLoggedCompile(Tial::Utility::Logger::Level::Nice2, path);
+		constexpr bool enabled = Tial::Utility::Logger::toBeLoggedCompile(Tial::Utility::Logger::Level::Nice2, 0);
+		[[Check::Verify]] disabled;
+		[[Check::Verify]] enabled;
+	}
+};
+
+class [[Testing::Case]] LiveLevelChange {
+	static constexpr int producers = 4;
+
+	void operator()() {
+		Capture &capture = Capture::instance();
+		capture.take();
+
+		std::atomic<bool> done{false};
+		Testing::Thread producer([&](){
+			while(!done.load())
+				LOGD << "live";
+		});
+		std::vector<Testing::Thread> threads(producers, producer);
+		for(int i = 0; i < producers; ++i)
+			threads[i]("producer");
+
+		for(int i = 0; i < 200; ++i) {
+			Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Info, TIAL_MODULE);
+			Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Nice3, TIAL_MODULE);
+		}
+		Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Info, TIAL_MODULE);
+		done = true;
+		for(auto &&thread: threads)
+			thread.join();
+		capture.take();
+
+		LOGD << "disabled";
+		Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Nice3, TIAL_MODULE);
+		LOGD << "enabled";
+		auto messages = capture.take();
+		[[Check::Verify]] messages.size() == 1u;
+		[[Check::Verify]] messages[0].output == "enabled";
+	}
+};
+
+class [[Testing::Case]] AcceptedLevel {
+	void operator()() {
+		static const Tial::Utility::Logger::Site site{
+			__FILE__, __LINE__, __FUNCTION__, TIAL_UTILITY_LANGUAGE_FUNCTION_SIGNATURE, TIAL_UTILITY_LANGUAGE_CURRENT_MODULE
+		};
+		// below every level a handler of the test executable accepts, and below the compile-time level
+		const Tial::Utility::Logger::Level lowest = static_cast<Tial::Utility::Logger::Level>(5);
+		const Tial::Utility::Logger::Level before = Tial::Utility::Logger::acceptedLevel();
+		Tial::Utility::Logger::setLoggingLevel(lowest, TIAL_MODULE);
+		bool skipped = !Tial::Utility::Logger::toBeLoggedRuntime(lowest, site)
+			&& !Tial::Utility::Logger::toBeLoggedRuntime(lowest, TIAL_MODULE);
+		[[Check::Verify]] skipped;
+
+		std::vector<std::string> lines;
+		auto handler = std::make_unique<Collect>(lines);
+		Collect *collect = handler.get();
+		Tial::Utility::Logger::addHandler(std::move(handler));
+		bool unchanged = Tial::Utility::Logger::acceptedLevel() == before;
+		[[Check::Verify]] unchanged;
+
+		collect->setLevel(lowest);
+		bool lowered = Tial::Utility::Logger::acceptedLevel() == lowest;
+		bool accepted = Tial::Utility::Logger::toBeLoggedRuntime(lowest, site)
+			&& Tial::Utility::Logger::toBeLoggedRuntime(lowest, TIAL_MODULE);
+		collect->setLevel(Tial::Utility::Logger::Level::Critical);
+		bool raised = Tial::Utility::Logger::acceptedLevel() == before;
+		bool skippedAgain = !Tial::Utility::Logger::toBeLoggedRuntime(lowest, site);
+		Tial::Utility::Logger::removeHandler(collect);
+		bool removed = Tial::Utility::Logger::acceptedLevel() == before;
+		Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Nice3, TIAL_MODULE);
+
+		[[Check::Verify]] lowered;
+		[[Check::Verify]] accepted;
+		[[Check::Verify]] raised;
+		[[Check::Verify]] skippedAgain;
+		[[Check::Verify]] removed;
+	}
+};
+
+class [[Testing::Case]] Routing {
+	void operator()() {
+		static const Tial::Utility::Logger::Site wildcards{
+			__FILE__, __LINE__, __FUNCTION__, TIAL_UTILITY_LANGUAGE_FUNCTION_SIGNATURE, "Routing::Wildcards::Glob"
+		};
+		static const Tial::Utility::Logger::Site other{
+			__FILE__, __LINE__, __FUNCTION__, TIAL_UTILITY_LANGUAGE_FUNCTION_SIGNATURE, "Routing::Other"
+		};
+		auto log = [](const Tial::Utility::Logger::Site &site, const char *text) {
+			Tial::Utility::Logger::Message message(site, Tial::Utility::Logger::Level::Debug, std::chrono::system_clock::now());
+			message.out() << text;
+		};
+
+		std::vector<std::string> wildcardsLines, routingLines;
+		auto wildcardsHandler = std::make_unique<Collect>(wildcardsLines);
+		auto routingHandler = std::make_unique<Collect>(routingLines);
+		Collect *wildcardsCollect = wildcardsHandler.get();
+		Collect *routingCollect = routingHandler.get();
+		Tial::Utility::Logger::addHandler(std::move(wildcardsHandler), {"Routing::Wildcards", "Routing::Wildcards::Glob"});
+		Tial::Utility::Logger::addHandler(std::move(routingHandler), {"Routing"});
+
+		log(wildcards, "first");
+		log(other, "second");
+
+		// below every level other handlers accept: only the subscribed modules pass it
+		const Tial::Utility::Logger::Level lowest = static_cast<Tial::Utility::Logger::Level>(5);
+		Tial::Utility::Logger::setLoggingLevel(lowest, "Routing");
+		wildcardsCollect->setLevel(lowest);
+		bool routedLevel = Tial::Utility::Logger::toBeLoggedRuntime(lowest, "Routing::Wildcards")
+			&& Tial::Utility::Logger::toBeLoggedRuntime(lowest, wildcards)
+			&& !Tial::Utility::Logger::toBeLoggedRuntime(lowest, "Routing::Wildcardsmith")
+			&& !Tial::Utility::Logger::toBeLoggedRuntime(lowest, other);
+		Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Nice3, "Routing");
+		wildcardsCollect->setLevel(Tial::Utility::Logger::Level::Nice3);
+
+		routingCollect->setLevel(Tial::Utility::Logger::Level::Critical);
+		log(other, "third");
+		log(wildcards, "fourth");
+		Tial::Utility::Logger::removeHandler(wildcardsCollect);
+		log(wildcards, "fifth");
+		Tial::Utility::Logger::removeHandler(routingCollect);
+
+		[[Check::Verify]] wildcardsLines == std::vector<std::string>({"first", "fourth"});
+		[[Check::Verify]] routingLines == std::vector<std::string>({"first", "second"});
+		[[Check::Verify]] routedLevel;
+	}
+};
+
+class [[Testing::Case]] HandlerHotSwap {
+	static constexpr int producers = 4;
+
+	class Counter: public Tial::Utility::Logger::Handler {
+	public:
+		std::atomic<std::size_t> count{0};
+
+		Counter(): Handler(Tial::Utility::Logger::Level::Nice3) {}
+
+		virtual void write(const Tial::Utility::Logger::Message&) override {
+			++count;
+		}
+	};
+
+	void operator()() {
+		Capture &capture = Capture::instance();
+		capture.take();
+
+		std::atomic<bool> done{false};
+		Testing::Thread producer([&](){
+			while(!done.load())
+				LOGD << "swap";
+		});
+		std::vector<Testing::Thread> threads(producers, producer);
+		for(int i = 0; i < producers; ++i)
+			threads[i]("producer");
+
+		std::size_t received = 0;
+		for(int i = 0; i < 50; ++i) {
+			auto handler = std::make_unique<Counter>();
+			Counter *counter = handler.get();
+			Tial::Utility::Logger::addHandler(std::move(handler));
+			std::this_thread::yield();
+			auto removed = Tial::Utility::Logger::removeHandler(counter);
+			[[Check::Verify]] removed.get() == counter;
+			std::size_t count = counter->count.load();
+			std::this_thread::yield();
+			bool unchanged = counter->count.load() == count;
+			[[Check::Verify]] unchanged;
+			received += count;
+		}
+		done = true;
+		for(auto &&thread: threads)
+			thread.join();
+		capture.take();
+
+		Counter unknown;
+		bool notFound = !Tial::Utility::Logger::removeHandler(&unknown);
+		[[Check::Verify]] notFound;
+		LOGI << "hot swap: " << received << " messages received by temporary handlers";
+	}
+};
+
+class [[Testing::Case]] LimitedStatements {
+	void operator()() {
+		Tial::Utility::Logger::setSuppressionReportInterval(std::chrono::steady_clock::duration::zero());
+		Capture &capture = Capture::instance();
+		capture.take();
+
+		for(int i = 0; i < 10; ++i)
+			LOGD_EVERY_N(3) << "every " << i;
+		auto every = capture.take();
+		[[Check::Verify]] every.size() == 4u;
+		[[Check::Verify]] every[3].output == "every 9";
+
+		for(int i = 0; i < 5; ++i)
+			LOGD_FIRST_N(2) << "first " << i;
+		auto first = capture.take();
+		[[Check::Verify]] first.size() == 2u;
+		[[Check::Verify]] first[1].output == "first 1";
+
+		for(int i = 0; i < 100; ++i)
+			LOGD_RATE(5) << "rate " << i;
+		auto rate = capture.take();
+		bool limited = rate.size() >= 5u && rate.size() <= 6u;
+		[[Check::Verify]] limited;
+
+		// limiters of disabled statements count nothing
+		Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Info, TIAL_MODULE);
+		for(int i = 0; i < 10; ++i)
+			LOGD_FIRST_N(1) << "disabled " << i;
+		Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Nice3, TIAL_MODULE);
+
+		Tial::Utility::Logger::reportSuppressed();
+		std::map<unsigned int, std::string> reports;
+		for(auto &&message: capture.take())
+			reports[message.site->line] = message.output;
+		[[Check::Verify]] reports.size() == 3u;
+		std::string everyReport = reports[every[0].site->line];
+		std::string firstReport = reports[first[0].site->line];
+		[[Check::Verify]] everyReport == "6 similar messages suppressed";
+		[[Check::Verify]] firstReport == "3 similar messages suppressed";
+		Tial::Utility::Logger::reportSuppressed();
+		[[Check::Verify]] capture.take().empty();
+		Tial::Utility::Logger::setSuppressionReportInterval(std::chrono::seconds(10));
+	}
+};
+
+class [[Testing::Case]] SuppressionReportAfterStorm {
+	void operator()() {
+		Capture &capture = Capture::instance();
+		capture.take();
+		Tial::Utility::Logger::setSuppressionReportInterval(std::chrono::milliseconds(50));
+
+		for(int i = 0; i < 10; ++i)
+			LOGD_FIRST_N(1) << "storm " << i;
+		auto storm = capture.take();
+		[[Check::Verify]] storm.size() == 1u;
+
+		// nothing is logged or suppressed after the storm, the report comes from the interval passing
+		std::vector<Captured> reports;
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while(reports.empty() && std::chrono::steady_clock::now() < deadline) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			reports = capture.take();
+		}
+		[[Check::Verify]] reports.size() == 1u;
+		[[Check::Verify]] reports[0].output == "9 similar messages suppressed";
+		Tial::Utility::Logger::setSuppressionReportInterval(std::chrono::seconds(10));
+	}
+};
+
+class [[Testing::Case]] MetadataAllocations {
+	void operator()() {
+		static const Tial::Utility::Logger::Site site{
+			__FILE__, __LINE__, __FUNCTION__, TIAL_UTILITY_LANGUAGE_FUNCTION_SIGNATURE, TIAL_UTILITY_LANGUAGE_CURRENT_MODULE
+		};
+		std::size_t before = allocations;
+		Tial::Utility::Logger::Message message(site, Tial::Utility::Logger::Level::Debug, std::chrono::system_clock::now());
+		std::size_t after = allocations;
+		Tial::Utility::Logger::Message detached(std::move(message));
+		[[Check::Verify]] after == before;
+		[[Check::Verify]] detached.site == &site;
+	}
+};
+
+class [[Testing::Case]] Asynchronous {
+	static constexpr int producers = 4;
+	static constexpr int count = 100;
+
+	void operator()() {
+		Capture &capture = Capture::instance();
+		capture.take();
+
+		Tial::Utility::Logger::enableAsynchronousMode(16);
+		std::atomic<int> nextProducer{0};
+		Testing::Thread producer([&](){
+			std::string name = "producer" + std::to_string(nextProducer++);
+			Tial::Utility::Thread::setName(name);
+			for(int i = 0; i < count; ++i)
+				LOGD << name.c_str() << " " << i;
+		});
+		std::vector<Testing::Thread> threads(producers, producer);
+		for(int i = 0; i < producers; ++i)
+			threads[i]("producer");
+		for(auto &&thread: threads)
+			thread.join();
+		Tial::Utility::Logger::flush();
+
+		auto messages = capture.take();
+		Tial::Utility::Logger::disableAsynchronousMode();
+
+		[[Check::Verify]] messages.size() == static_cast<std::size_t>(producers*count);
+		std::map<std::string, int> next;
+		bool ordered = true;
+		for(auto &&message: messages) {
+			ordered = ordered && message.output == message.thread + " " + std::to_string(next[message.thread]);
+			next[message.thread]++;
+		}
+		[[Check::Verify]] ordered;
+		[[Check::Verify]] next.size() == static_cast<std::size_t>(producers);
+	}
+};
+
+class [[Testing::Case]] QueueOverflow {
+	// one message held by the writer, then more than the queue of 4 holds; returns what the handler received
+	std::vector<std::string> overflow(const Tial::Utility::Logger::QueuePolicy &policy) {
+		std::vector<std::string> lines;
+		auto gate = std::make_unique<Gate>(lines);
+		Gate *held = gate.get();
+		Tial::Utility::Logger::addHandler(std::move(gate), {TIAL_MODULE});
+		Tial::Utility::Logger::enableAsynchronousMode(4, policy);
+
+		LOGI << "held";
+		held->waitEntered();
+		for(int i = 0; i < 10; ++i)
+			LOGI << "info " << i;
+		LOGW << "warning";
+
+		held->release();
+		Tial::Utility::Logger::flush();
+		Tial::Utility::Logger::disableAsynchronousMode();
+		Tial::Utility::Logger::removeHandler(held);
+		return lines;
+	}
+
+	void operator()() {
+		// the priority lane is taken first
+		std::vector<std::string> expected{"held", "warning", "info 0", "info 1", "info 2", "info 3"};
+
+		Tial::Utility::Logger::QueuePolicy policy;
+		policy.overflow = Tial::Utility::Logger::QueuePolicy::Overflow::DropNewest;
+		uint64_t dropped = Tial::Utility::Logger::droppedMessages(Tial::Utility::Logger::Level::Info);
+		[[Check::Verify]] overflow(policy) == expected;
+		uint64_t droppedNewest = Tial::Utility::Logger::droppedMessages(Tial::Utility::Logger::Level::Info) - dropped;
+		[[Check::Verify]] droppedNewest == 6u;
+
+		policy.overflow = Tial::Utility::Logger::QueuePolicy::Overflow::DropBelow;
+		policy.level = Tial::Utility::Logger::Level::Warning;
+		dropped = Tial::Utility::Logger::droppedMessages(Tial::Utility::Logger::Level::Info);
+		[[Check::Verify]] overflow(policy) == expected;
+		uint64_t droppedBelow = Tial::Utility::Logger::droppedMessages(Tial::Utility::Logger::Level::Info) - dropped;
+		[[Check::Verify]] droppedBelow == 6u;
+		[[Check::Verify]] Tial::Utility::Logger::droppedMessages(Tial::Utility::Logger::Level::Warning) == 0u;
+
+		const std::string fileName = "TestLoggerSpill.log";
+		std::remove(fileName.c_str());
+		policy.overflow = Tial::Utility::Logger::QueuePolicy::Overflow::Spill;
+		policy.spillFileName = fileName;
+		uint64_t spilled = Tial::Utility::Logger::spilledMessages(Tial::Utility::Logger::Level::Info);
+		[[Check::Verify]] overflow(policy) == expected;
+		uint64_t spilledInfo = Tial::Utility::Logger::spilledMessages(Tial::Utility::Logger::Level::Info) - spilled;
+		[[Check::Verify]] spilledInfo == 6u;
+		auto lines = readLines(fileName);
+		[[Check::Verify]] lines.size() == 6u;
+		[[Check::Verify]] lines[5].substr(lines[5].size()-6) == "info 9";
+		std::remove(fileName.c_str());
+	}
+};
+
+class [[Testing::Case]] SwitchAsynchronousMode {
+	void operator()() {
+		const int producers = 4;
+		const int count = 200;
+		auto handler = std::make_unique<Count>();
+		Count *counted = handler.get();
+		Tial::Utility::Logger::addHandler(std::move(handler), {TIAL_MODULE});
+		uint64_t dropped = Tial::Utility::Logger::droppedMessages(Tial::Utility::Logger::Level::Info);
+
+		Tial::Utility::Logger::QueuePolicy policy;
+		policy.overflow = Tial::Utility::Logger::QueuePolicy::Overflow::DropNewest;
+		policy.priorityQueueSize = 8;
+		std::atomic<int> running{producers};
+		Testing::Thread producer([&](){
+			for(int i = 0; i < count; ++i) {
+				LOGI << "info " << i;
+				LOGW << "warning " << i;
+			}
+			--running;
+		});
+		std::vector<Testing::Thread> threads(producers, producer);
+		for(int i = 0; i < producers; ++i)
+			threads[i]("producer");
+		// messages are pushed to writers being deleted and left in both lanes of stopping writers
+		while(running.load() > 0) {
+			Tial::Utility::Logger::enableAsynchronousMode(8, policy);
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+			Tial::Utility::Logger::disableAsynchronousMode();
+		}
+		for(auto &&thread: threads)
+			thread.join();
+		auto removed = Tial::Utility::Logger::removeHandler(counted);
+		int warnings = counted->warnings.load();
+		int infos = counted->infos.load();
+
+		int droppedInfos = static_cast<int>(Tial::Utility::Logger::droppedMessages(Tial::Utility::Logger::Level::Info)
+			- dropped);
+		[[Check::Verify]] warnings == producers*count;
+		[[Check::Verify]] infos + droppedInfos == producers*count;
+	}
+};
+
+class [[Testing::Case]] Deduplicate {
+	void operator()() {
+		std::vector<std::string> lines;
+		auto collect = std::make_unique<Collect>(lines);
+		Collect &inner = *collect;
+		{
+			Tial::Utility::Logger::Handlers::Deduplicate handler(Tial::Utility::Logger::Level::Nice3, std::move(collect),
+				std::chrono::hours(1));
+			for(int i = 0; i < 100; ++i)
+				handler.log(record("storm", Tial::Utility::Logger::Level::Warning));
+			handler.log(record("storm", Tial::Utility::Logger::Level::Critical));
+			handler.log(record("calm", Tial::Utility::Logger::Level::Warning));
+
+			auto a = record("batch", Tial::Utility::Logger::Level::Warning);
+			auto b = record("batch", Tial::Utility::Logger::Level::Warning);
+			auto c = record("after batch", Tial::Utility::Logger::Level::Warning);
+			std::size_t batches = inner.batches;
+			handler.log(std::vector<const Tial::Utility::Logger::Message*>{&a, &b, &b, &c});
+			[[Check::Verify]] inner.batches == batches + 1;
+
+			handler.log(record("tail", Tial::Utility::Logger::Level::Warning));
+			handler.log(record("tail", Tial::Utility::Logger::Level::Warning));
+		}
+
+		std::vector<std::string> expected{
+			"storm", "last message repeated 99 times", "storm", "calm",
+			"batch", "last message repeated 2 times", "after batch",
+			"tail", "last message repeated 1 times"
+		};
+		[[Check::Verify]] lines == expected;
+
+		std::vector<std::string> unwindowed;
+		{
+			Tial::Utility::Logger::Handlers::Deduplicate handler(Tial::Utility::Logger::Level::Nice3,
+				std::make_unique<Collect>(unwindowed), std::chrono::milliseconds(0));
+			for(int i = 0; i < 3; ++i)
+				handler.log(record("storm", Tial::Utility::Logger::Level::Warning));
+		}
+		[[Check::Verify]] unwindowed.size() == 3u;
+	}
+};
+
+class [[Testing::Case]] DeduplicateSilence {
+	void operator()() {
+		auto count = std::make_unique<Count>();
+		Count &inner = *count;
+		Tial::Utility::Logger::Handlers::Deduplicate handler(Tial::Utility::Logger::Level::Nice3, std::move(count),
+			std::chrono::milliseconds(20));
+		for(int i = 0; i < 10; ++i)
+			handler.log(record("storm", Tial::Utility::Logger::Level::Warning));
+		int burst = inner.warnings;
+
+		// nothing else is logged, the summary has to come from the window expiring
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while(inner.warnings < 2 && std::chrono::steady_clock::now() < deadline)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		int reported = inner.warnings;
+		[[Check::Verify]] burst == 1;
+		[[Check::Verify]] reported == 2;
+	}
+};
+
+class [[Testing::Case]] FileFlushPolicy {
+	void operator()() {
+		const std::string fileName = "TestLoggerFlushPolicy.log";
+		std::remove(fileName.c_str());
+
+		Tial::Utility::Logger::Handlers::File::FlushPolicy policy;
+		policy.interval = std::chrono::milliseconds(0);
+		policy.critical = true;
+		{
+			Tial::Utility::Logger::Handlers::File file(Tial::Utility::Logger::Level::Nice3, fileName, policy);
+			file.log(record("first", Tial::Utility::Logger::Level::Info));
+			file.log(record("second", Tial::Utility::Logger::Level::Warning));
+			[[Check::Verify]] readLines(fileName).empty();
+
+			file.log(record("third", Tial::Utility::Logger::Level::Critical));
+			[[Check::Verify]] readLines(fileName).size() == 3u;
+
+			file.log(record("fourth", Tial::Utility::Logger::Level::Info));
+			[[Check::Verify]] readLines(fileName).size() == 3u;
+			file.flush();
+			[[Check::Verify]] readLines(fileName).size() == 4u;
+
+			file.log(record("fifth", Tial::Utility::Logger::Level::Info));
+		}
+		auto lines = readLines(fileName);
+		[[Check::Verify]] lines.size() == 5u;
+		[[Check::Verify]] lines[4].substr(lines[4].size()-5) == "fifth";
+
+		policy.bytes = 1;
+		policy.critical = false;
+		std::remove(fileName.c_str());
+		{
+			Tial::Utility::Logger::Handlers::File file(Tial::Utility::Logger::Level::Nice3, fileName, policy);
+			file.log(record("first", Tial::Utility::Logger::Level::Info));
+			[[Check::Verify]] readLines(fileName).size() == 1u;
+		}
+		std::remove(fileName.c_str());
+	}
+};
+
+class [[Testing::Case]] FileBatch {
+	void operator()() {
+		const std::string fileName = "TestLoggerBatch.log";
+		std::remove(fileName.c_str());
+
+		Tial::Utility::Logger::Handlers::File::FlushPolicy policy;
+		policy.interval = std::chrono::milliseconds(0);
+		policy.critical = false;
+		{
+			Tial::Utility::Logger::Handlers::File file(Tial::Utility::Logger::Level::Info, fileName, policy, 64);
+			std::vector<Tial::Utility::Logger::Message> records;
+			records.push_back(record("first", Tial::Utility::Logger::Level::Info));
+			records.push_back(record("skipped", Tial::Utility::Logger::Level::Debug));
+			records.push_back(record("second\nline", Tial::Utility::Logger::Level::Warning));
+			std::vector<const Tial::Utility::Logger::Message*> batch;
+			for(auto &&r: records)
+				batch.push_back(&r);
+
+			file.log(batch);
+			auto lines = readLines(fileName);
+			[[Check::Verify]] lines.size() == 2u;
+			[[Check::Verify]] lines[1].substr(lines[1].size()-12) == "second\\nline";
+		}
+		std::remove(fileName.c_str());
+	}
+};
+
+class [[Testing::Case]] FileRotation {
+	void operator()() {
+		const std::string prefix = "TestLoggerRotation-";
+		removeFiles(filesWithPrefix(prefix));
+
+		Tial::Utility::Logger::Handlers::File::RotationPolicy rotation;
+		rotation.bytes = 300;
+		rotation.segments = 2;
+		rotation.compress = true;
+		std::string active;
+		{
+			Tial::Utility::Logger::Handlers::File file(Tial::Utility::Logger::Level::Nice3, prefix + "%t.log",
+				Tial::Utility::Logger::Handlers::File::FlushPolicy(), 64*1024, rotation);
+			std::string first = file.currentFileName();
+			for(int i = 0; i < 20; ++i)
+				file.log(record("message " + std::to_string(i), Tial::Utility::Logger::Level::Info));
+			active = file.currentFileName();
+			[[Check::Verify]] active != first;
+		}
+
+		auto files = filesWithPrefix(prefix);
+		std::size_t compressed = std::count_if(files.begin(), files.end(), [](const std::string &name){
+			return name.size() > 3 && name.substr(name.size()-3) == ".gz";
+		});
+		[[Check::Verify]] files.size() == 3u;
+		[[Check::Verify]] compressed == 2u;
+		[[Check::Verify]] std::find(files.begin(), files.end(), active) != files.end();
+		removeFiles(files);
+	}
+};
+
+class [[Testing::Case]] FileRotationExistingSegments {
+	void operator()() {
+		const std::string prefix = "TestLoggerRotationOld-";
+		removeFiles(filesWithPrefix(prefix));
+		const std::string oldest = prefix + "2000-01-01T00:00:01.000000.log.gz";
+		const std::string older = prefix + "2000-01-01T00:00:02.000000.log";
+		const std::string old = prefix + "2000-01-01T00:00:02.000000.log.1";
+		const std::vector<std::string> unrelated{prefix + "notes.txt", prefix + "notes.log"};
+		for(auto &&name: {oldest, older, old, unrelated[0], unrelated[1]})
+			std::ofstream(name) << "left by an earlier run\n";
+
+		Tial::Utility::Logger::Handlers::File::RotationPolicy rotation;
+		rotation.bytes = 300;
+		rotation.segments = 2;
+		{
+			Tial::Utility::Logger::Handlers::File file(Tial::Utility::Logger::Level::Nice3, prefix + "%t.log",
+				Tial::Utility::Logger::Handlers::File::FlushPolicy(), 64*1024, rotation);
+			auto files = filesWithPrefix(prefix);
+			bool oldestKept = std::find(files.begin(), files.end(), oldest) != files.end();
+			[[Check::Verify]] !oldestKept;
+			[[Check::Verify]] files.size() == 5u;
+
+			for(int i = 0; i < 20; ++i)
+				file.log(record("message " + std::to_string(i), Tial::Utility::Logger::Level::Info));
+		}
+
+		auto files = filesWithPrefix(prefix);
+		bool olderKept = std::find(files.begin(), files.end(), older) != files.end();
+		bool oldKept = std::find(files.begin(), files.end(), old) != files.end();
+		bool unrelatedKept = std::find(files.begin(), files.end(), unrelated[0]) != files.end()
+			&& std::find(files.begin(), files.end(), unrelated[1]) != files.end();
+		[[Check::Verify]] !olderKept;
+		[[Check::Verify]] !oldKept;
+		[[Check::Verify]] unrelatedKept;
+		[[Check::Verify]] files.size() == 5u;
+		removeFiles(files);
+
+		// without %t, segments are the name followed by a timestamp
+		const std::string name = "TestLoggerRotationOldFixed.log";
+		removeFiles(filesWithPrefix(name));
+		const std::string segment = name + ".2000-01-01T00:00:01.000000";
+		const std::string backup = name + ".bak";
+		for(auto &&file: {segment, backup})
+			std::ofstream(file) << "left by an earlier run\n";
+		rotation.segments = 1;
+		{
+			Tial::Utility::Logger::Handlers::File file(Tial::Utility::Logger::Level::Nice3, name,
+				Tial::Utility::Logger::Handlers::File::FlushPolicy(), 64*1024, rotation);
+			for(int i = 0; i < 20; ++i)
+				file.log(record("message " + std::to_string(i), Tial::Utility::Logger::Level::Info));
+		}
+		files = filesWithPrefix(name);
+		bool segmentKept = std::find(files.begin(), files.end(), segment) != files.end();
+		bool backupKept = std::find(files.begin(), files.end(), backup) != files.end();
+		[[Check::Verify]] !segmentKept;
+		[[Check::Verify]] backupKept;
+		[[Check::Verify]] files.size() == 3u;
+		removeFiles(files);
+	}
+};
+
+class [[Testing::Case]] FileRotationConcurrent {
+	void operator()() {
+		const std::string name = "TestLoggerRotationConcurrent.log";
+		removeFiles(filesWithPrefix(name));
+		const int producers = 4;
+		const int count = 200;
+
+		Tial::Utility::Logger::Handlers::File::RotationPolicy rotation;
+		rotation.bytes = 2000;
+		{
+			Tial::Utility::Logger::Handlers::File file(Tial::Utility::Logger::Level::Nice3, name,
+				Tial::Utility::Logger::Handlers::File::FlushPolicy(), 256, rotation);
+			Testing::Thread producer([&file, count](){
+				for(int i = 0; i < count; ++i)
+					file.log(record("message " + std::to_string(i), Tial::Utility::Logger::Level::Info));
+			});
+			std::vector<Testing::Thread> threads(producers, producer);
+			for(int i = 0; i < producers; ++i)
+				threads[i]("producer");
+			for(auto &&thread: threads)
+				thread.join();
+		}
+
+		// every line ends up in exactly one segment, whichever side of a switch it was written on
+		auto files = filesWithPrefix(name);
+		std::size_t lines = 0;
+		for(auto &&file: files)
+			lines += readLines(file).size();
+		[[Check::Verify]] files.size() > 2u;
+		[[Check::Verify]] lines == static_cast<std::size_t>(producers*count);
+		removeFiles(files);
+	}
+};
+
+class [[Testing::Case]] FileRotationWithoutTimePattern {
+	void operator()() {
+		const std::string name = "TestLoggerRotationFixed.log";
+		removeFiles(filesWithPrefix(name));
+
+		Tial::Utility::Logger::Handlers::File::RotationPolicy rotation;
+		rotation.bytes = 300;
+		rotation.segments = 1;
+		{
+			Tial::Utility::Logger::Handlers::File file(Tial::Utility::Logger::Level::Nice3, name,
+				Tial::Utility::Logger::Handlers::File::FlushPolicy(), 64*1024, rotation);
+			for(int i = 0; i < 20; ++i)
+				file.log(record("message " + std::to_string(i), Tial::Utility::Logger::Level::Info));
+			[[Check::Verify]] file.currentFileName() == name;
+		}
+
+		auto files = filesWithPrefix(name);
+		[[Check::Verify]] files.size() == 2u;
+		[[Check::Verify]] files[0] == name;
+		removeFiles(files);
+	}
+};
+
+class [[Testing::Case]] BinaryRoundTrip {
+	void operator()() {
+		const std::string binaryName = "TestLoggerBinary.tlog";
+		const std::string textName = "TestLoggerBinary.log";
+		std::remove(binaryName.c_str());
+		std::remove(textName.c_str());
+
+		std::vector<std::string> expected;
+		{
+			Tial::Utility::Logger::Handlers::Binary binary(Tial::Utility::Logger::Level::Info, binaryName);
+			Tial::Utility::Logger::Handlers::File file(Tial::Utility::Logger::Level::Info, textName);
+			for(int i = 0; i < 50; ++i) {
+				auto message = record("message\t" + std::to_string(i), Tial::Utility::Logger::Level::Info);
+				binary.log(message);
+				file.log(message);
+				expected.push_back(Tial::Utility::Logger::Handlers::File::format(message));
+			}
+			binary.log(record("skipped", Tial::Utility::Logger::Level::Debug));
+		}
+
+		std::vector<std::string> decoded;
+		Tial::Utility::Logger::Handlers::Binary::decode(binaryName, [&decoded](const Tial::Utility::Logger::Message &message) {
+			decoded.push_back(Tial::Utility::Logger::Handlers::File::format(message));
+		});
+		[[Check::Verify]] decoded == expected;
+
+		auto binarySize = std::ifstream(binaryName, std::ios::binary | std::ios::ate).tellg();
+		auto textSize = std::ifstream(textName, std::ios::binary | std::ios::ate).tellg();
+		[[Check::Verify]] binarySize < textSize;
+
+		std::remove(binaryName.c_str());
+		std::remove(textName.c_str());
+	}
+};
+
+class [[Testing::Case]] JsonLines {
+	void operator()() {
+		const std::string fileName = "TestLoggerJsonLines.log";
+		std::remove(fileName.c_str());
+		{
+			Tial::Utility::Logger::Handlers::JsonLines json(Tial::Utility::Logger::Level::Info, fileName);
+			auto message = record("quote \" backslash \\ newline \n bell \a", Tial::Utility::Logger::Level::Warning);
+			message.thread = "main";
+			message.time = Tial::Utility::Logger::Message::TimePoint(std::chrono::microseconds(1445000000123456));
+			message.out().kv("latency_us", 123).kv("ratio", 0.1).kv("ok", false).kv("path", "/a\"b");
+			json.log(message);
+			json.log(record("plain", Tial::Utility::Logger::Level::Info));
+		}
+
+		auto lines = readLines(fileName);
+		[[Check::Verify]] lines.size() == 2u;
+		// braces would be taken for blocks by the test preprocessor, so the expected text spells them as <>
+		std::string json = lines[0];
+		std::replace(json.begin(), json.end(), char(123), '<');
+		std::replace(json.begin(), json.end(), char(125), '>');
+		std::string prefix = "<\"timestamp\":1445000000123456,\"level\":\"WARNING\",\"thread\":\"main\",";
+		bool prefixed = json.compare(0, prefix.size(), prefix) == 0;
+		[[Check::Verify]] prefixed;
+		std::string suffix = "\"message\":\"quote \\\" backslash \\\\ newline \\n bell \\u0007\","
+			"\"fields\":<\"latency_us\":123,\"ratio\":0.1,\"ok\":false,\"path\":\"/a\\\"b\">>";
+		bool suffixed = json.size() > suffix.size() && json.compare(json.size() - suffix.size(), suffix.size(), suffix) == 0;
+		[[Check::Verify]] suffixed;
+		bool withoutFields = lines[1].find("\"message\":\"plain\"") != std::string::npos
+			&& lines[1].find("\"fields\"") == std::string::npos;
+		[[Check::Verify]] withoutFields;
+		std::remove(fileName.c_str());
+	}
+};
+
+class [[Testing::Case]] FlightRecorderRing {
+	static std::vector<std::string> decode(const std::string &fileName, std::size_t bytes = 0) {
+		std::vector<std::string> decoded;
+		Tial::Utility::Logger::Handlers::FlightRecorder::decode(fileName, [&decoded](const Tial::Utility::Logger::Message &message) {
+			decoded.push_back(Tial::Utility::Logger::Handlers::File::format(message));
+		}, bytes);
+		return decoded;
+	}
+
+	void operator()() {
+		const std::string fileName = "TestLoggerFlightRecorder.ring";
+		std::remove(fileName.c_str());
+
+		std::vector<std::string> expected;
+		{
+			Tial::Utility::Logger::Handlers::FlightRecorder recorder(Tial::Utility::Logger::Level::Nice3, fileName, 4096);
+			for(int i = 0; i < 200; ++i) {
+				auto message = record("message " + std::to_string(i), Tial::Utility::Logger::Level::Nice2);
+				recorder.log(message);
+				expected.push_back(Tial::Utility::Logger::Handlers::File::format(message));
+			}
+		}
+
+		// only the newest messages fit, and they come back complete and in order
+		auto decoded = decode(fileName);
+		bool partial = !decoded.empty() && decoded.size() < expected.size();
+		[[Check::Verify]] partial;
+		bool newest = std::equal(decoded.begin(), decoded.end(), expected.end() - decoded.size());
+		[[Check::Verify]] newest;
+
+		auto limited = decode(fileName, 1024);
+		bool fewer = !limited.empty() && limited.size() < decoded.size();
+		[[Check::Verify]] fewer;
+		bool limitedNewest = std::equal(limited.begin(), limited.end(), expected.end() - limited.size());
+		[[Check::Verify]] limitedNewest;
+
+		// a ring of the same capacity is continued by the next recorder
+		{
+			Tial::Utility::Logger::Handlers::FlightRecorder recorder(Tial::Utility::Logger::Level::Nice3, fileName, 4096);
+			auto message = record("reopened", Tial::Utility::Logger::Level::Critical);
+			recorder.log(message);
+			expected.push_back(Tial::Utility::Logger::Handlers::File::format(message));
+		}
+		auto continued = decode(fileName);
+		bool continuedNewest = continued.size() >= 2u
+			&& std::equal(continued.begin(), continued.end(), expected.end() - continued.size());
+		[[Check::Verify]] continuedNewest;
+
+		std::remove(fileName.c_str());
+	}
+};
+
+class [[Testing::Case]] SharedRingProcesses {
+	static constexpr int producers = 4;
+	static constexpr int count = 200;
+
+	void operator()() {
+		const std::string name = "/TialTestSharedRing-" + std::to_string(::getpid());
+		Tial::Utility::Logger::Handlers::SharedRing::remove(name);
+		Tial::Utility::Logger::Handlers::SharedRing::Collector collector(name, 1024, 256);
+
+		std::vector<pid_t> children;
+		for(int p = 0; p < producers; ++p) {
+			pid_t child = ::fork();
+			if(child == 0) {
+				Tial::Utility::Logger::Handlers::SharedRing ring(Tial::Utility::Logger::Level::Nice3, name);
+				for(int i = 0; i < count; ++i)
+					ring.log(record(std::to_string(p) + " " + std::to_string(i), Tial::Utility::Logger::Level::Info));
+				::_exit(0);
+			}
+			children.push_back(child);
+		}
+
+		std::vector<std::string> lines;
+		Collect collect(lines);
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while(lines.size() < static_cast<std::size_t>(producers*count) && std::chrono::steady_clock::now() < deadline)
+			if(!collector.drain(collect))
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		bool exited = true;
+		for(auto &&child: children) {
+			int status = 0;
+			exited = exited && ::waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+		}
+		[[Check::Verify]] exited;
+		[[Check::Verify]] collector.dropped() == 0u;
+		[[Check::Verify]] lines.size() == static_cast<std::size_t>(producers*count);
+
+		// messages of each process arrive complete and in order, marked with its process id
+		std::map<std::string, int> next;
+		std::map<std::string, std::string> process;
+		bool ordered = true;
+		for(std::size_t i = 0; i < lines.size(); ++i) {
+			std::string producer = lines[i].substr(0, lines[i].find(' '));
+			std::string pid = collect.threads[i].substr(0, collect.threads[i].find('/'));
+			ordered = ordered && lines[i] == producer + " " + std::to_string(next[producer]++);
+			ordered = ordered && process.emplace(producer, pid).first->second == pid;
+		}
+		[[Check::Verify]] ordered;
+		[[Check::Verify]] next.size() == static_cast<std::size_t>(producers);
+		Tial::Utility::Logger::Handlers::SharedRing::remove(name);
+	}
+};
+
+class [[Testing::Case]] CrashHandler {
+	void operator()() {
+		const int count = 50;
+		for(bool asynchronous: {false, true}) {
+			const std::string fileName = "TestLoggerCrash.log";
+			std::remove(fileName.c_str());
+
+			pid_t child = ::fork();
+			if(child == 0) {
+				// keeps the stack trace written to the standard error out of the test output
+				int null = ::open("/dev/null", O_WRONLY);
+				::dup2(null, STDERR_FILENO);
+
+				Tial::Utility::Logger::installCrashHandler();
+				Tial::Utility::Logger::Handlers::File::FlushPolicy policy;
+				policy.interval = std::chrono::milliseconds(0);
+				policy.critical = false;
+				Tial::Utility::Logger::addHandler(std::make_unique<Tial::Utility::Logger::Handlers::File>(
+					Tial::Utility::Logger::Level::Nice3, fileName, policy));
+				std::vector<std::string> lines;
+				if(asynchronous) {
+					// with the writer held, the messages below are all still queued at the crash
+					auto gate = std::make_unique<Gate>(lines);
+					Gate *held = gate.get();
+					Tial::Utility::Logger::addHandler(std::move(gate));
+					Tial::Utility::Logger::enableAsynchronousMode(1024);
+					LOGW << "held";
+					held->waitEntered();
+				}
+				for(int i = 0; i < count; ++i)
+					LOGW << "before crash " << i;
+				std::abort();
+				::_exit(0);
+			}
+
+			int status = 0;
+			bool crashed = ::waitpid(child, &status, 0) == child && WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT;
+			[[Check::Verify]] crashed;
+
+			auto lines = readLines(fileName);
+			int messages = 0;
+			bool banner = false;
+			std::size_t frames = 0;
+			for(auto &&line: lines) {
+				messages += line.find("before crash ") != std::string::npos;
+				banner = banner || line.find("SIGABRT") != std::string::npos;
+				frames += banner && line.find("[0x") != std::string::npos;
+			}
+			[[Check::Verify]] messages == count;
+			[[Check::Verify]] banner;
+			[[Check::Verify]] frames > 0u;
+			std::remove(fileName.c_str());
+		}
+	}
+};
+
+class [[Testing::Case]] SharedRingFull {
+	void operator()() {
+		const std::string name = "/TialTestSharedRingFull-" + std::to_string(::getpid());
+		Tial::Utility::Logger::Handlers::SharedRing::remove(name);
+		Tial::Utility::Logger::Handlers::SharedRing ring(Tial::Utility::Logger::Level::Nice3, name, 4, 256);
+		for(int i = 0; i < 10; ++i)
+			ring.log(record("message " + std::to_string(i), Tial::Utility::Logger::Level::Info));
+		[[Check::Verify]] ring.dropped() == 6u;
+
+		std::vector<std::string> lines;
+		Collect collect(lines);
+		Tial::Utility::Logger::Handlers::SharedRing::Collector collector(name);
+		[[Check::Verify]] collector.drain(collect) == 4u;
+		[[Check::Verify]] lines.back() == "message 3";
+		ring.log(record("after drain", Tial::Utility::Logger::Level::Info));
+		[[Check::Verify]] collector.drain(collect) == 1u;
+		[[Check::Verify]] lines.back() == "after drain";
+		Tial::Utility::Logger::Handlers::SharedRing::remove(name);
+	}
+};
+
+// The first read of stalledPage stops the reading thread in the SIGSEGV handler until stalledResumed is set,
+// then makes the page readable so that the read is retried; a message whose module name lies there holds its
+// writer between claiming a slot and committing it.
+char *stalledPage = nullptr;
+std::atomic<bool> stalledRead{false};
+std::atomic<bool> stalledResumed{false};
+int stalledNotify = -1;
+
+void stallRead(int, siginfo_t *info, void*) {
+	char *address = static_cast<char*>(info->si_addr);
+	const std::size_t pageSize = ::sysconf(_SC_PAGESIZE);
+	if(address < stalledPage || address >= stalledPage + pageSize) {
+		::signal(SIGSEGV, SIG_DFL);
+		return;
+	}
+	stalledRead = true;
+	char stalled = 0;
+	if(stalledNotify >= 0 && ::write(stalledNotify, &stalled, 1) != 1)
+		::_exit(1);
+	const struct timespec pause{0, 1000000};
+	while(!stalledResumed)
+		::nanosleep(&pause, nullptr);
+	::mprotect(stalledPage, pageSize, PROT_READ);
+}
+
+void prepareStalledPage() {
+	const std::size_t pageSize = ::sysconf(_SC_PAGESIZE);
+	stalledPage = static_cast<char*>(::mmap(nullptr, pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+		-1, 0));
+	std::strcpy(stalledPage, "Stalled");
+	::mprotect(stalledPage, pageSize, PROT_NONE);
+	stalledRead = false;
+	stalledResumed = false;
+}
+
+void logStalled(Tial::Utility::Logger::Handler &handler) {
+	const Tial::Utility::Logger::Site site{
+		__FILE__, __LINE__, __FUNCTION__, TIAL_UTILITY_LANGUAGE_FUNCTION_SIGNATURE,
+		std::experimental::string_view(stalledPage, 7)
+	};
+	Tial::Utility::Logger::Message pending(site, Tial::Utility::Logger::Level::Info, std::chrono::system_clock::now());
+	pending.out() << "stalled";
+	Tial::Utility::Logger::Message message(std::move(pending));
+	handler.log(message);
+}
+
+class [[Testing::Case]] SharedRingStalledWriter {
+	void operator()() {
+		const std::string name = "/TialTestSharedRingStalled-" + std::to_string(::getpid());
+		Tial::Utility::Logger::Handlers::SharedRing::remove(name);
+		Tial::Utility::Logger::Handlers::SharedRing ring(Tial::Utility::Logger::Level::Nice3, name, 2, 256);
+		Tial::Utility::Logger::Handlers::SharedRing::Collector collector(name);
+		std::vector<std::string> lines;
+		Collect collect(lines);
+		auto drainUntil = [&](uint64_t dropped) {
+			auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+			while(collector.dropped() < dropped && std::chrono::steady_clock::now() < deadline)
+				if(!collector.drain(collect))
+					std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			collector.drain(collect);
+		};
+
+		struct sigaction action, previous;
+		std::memset(&action, 0, sizeof(action));
+		action.sa_sigaction = stallRead;
+		action.sa_flags = SA_SIGINFO;
+		::sigaction(SIGSEGV, &action, &previous);
+
+		// the writer claims position 0 and stops while filling the slot
+		prepareStalledPage();
+		Testing::Thread writer([&ring](){
+			logStalled(ring);
+		});
+		writer("stalled");
+		while(!stalledRead)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		ring.log(record("behind", Tial::Utility::Logger::Level::Info));
+		drainUntil(1);
+		std::vector<std::string> skipped{"behind"};
+		[[Check::Verify]] lines == skipped;
+
+		// the next lap may not share the slot with the stalled writer
+		ring.log(record("next lap", Tial::Utility::Logger::Level::Info));
+		[[Check::Verify]] ring.dropped() == 2u;
+
+		// once the stalled writer is done, its slot is free again, and its late message is not collected
+		stalledResumed = true;
+		writer.join();
+		ring.log(record("after", Tial::Utility::Logger::Level::Info));
+		collector.drain(collect);
+		std::vector<std::string> resumed{"behind", "after"};
+		[[Check::Verify]] lines == resumed;
+
+		// a writer that dies while filling its slot leaves it to the next lap
+		int notify[2];
+		bool piped = ::pipe(notify) == 0;
+		[[Check::Verify]] piped;
+		stalledNotify = notify[1];
+		const std::size_t pageSize = ::sysconf(_SC_PAGESIZE);
+		::munmap(stalledPage, pageSize);
+		prepareStalledPage();
+		pid_t child = ::fork();
+		if(child == 0) {
+			logStalled(ring);
+			::_exit(0);
+		}
+		char stalled;
+		bool notified = ::read(notify[0], &stalled, 1) == 1;
+		[[Check::Verify]] notified;
+		::kill(child, SIGKILL);
+		int status = 0;
+		bool killed = ::waitpid(child, &status, 0) == child && WIFSIGNALED(status);
+		[[Check::Verify]] killed;
+		drainUntil(3);
+		ring.log(record("after death", Tial::Utility::Logger::Level::Info));
+		ring.log(record("reclaimed", Tial::Utility::Logger::Level::Info));
+		collector.drain(collect);
+		std::vector<std::string> reclaimed{"behind", "after", "after death", "reclaimed"};
+		[[Check::Verify]] lines == reclaimed;
+		[[Check::Verify]] ring.dropped() == 3u;
+
+		::sigaction(SIGSEGV, &previous, nullptr);
+		stalledNotify = -1;
+		::close(notify[0]);
+		::close(notify[1]);
+		::munmap(stalledPage, pageSize);
+		Tial::Utility::Logger::Handlers::SharedRing::remove(name);
+	}
+};
+
+}
+}
+}
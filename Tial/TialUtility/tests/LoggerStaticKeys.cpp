@@ -0,0 +1,81 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+// every constant-level statement of this file is emitted with a static key
+#ifndef TIAL_UTILITY_LOGGER_STATIC_KEYS
+#define TIAL_UTILITY_LOGGER_STATIC_KEYS
+#endif
+
+#include <TialTesting/TialTesting.hpp>
+#include <TialUtility/TialUtility.hpp>
+
+#define TIAL_MODULE "Tial::Utility::Logger/StaticKeysTest"
+
+[[Tial::Testing::Typedef]] namespace Testing = Tial::Testing;
+[[Tial::Testing::Typedef]] namespace Check = Tial::Testing::Check;
+
+namespace [[Testing::Suite]] Tial {
+namespace [[Testing::Suite]] Utility {
+namespace [[Testing::Suite]] LoggerStaticKeys {
+
+class Collect: public Tial::Utility::Logger::Handler {
+public:
+	std::vector<std::string> &lines;
+
+	explicit Collect(std::vector<std::string> &lines): Handler(Tial::Utility::Logger::Level::Nice3), lines(lines) {}
+
+	virtual void write(const Tial::Utility::Logger::Message &message) override {
+		lines.push_back(message.stream.output());
+	}
+};
+
+void keyed(int i) {
+	LOGI << "keyed " << i;
+}
+
+class [[Testing::Case]] Patching {
+	void operator()() {
+		std::vector<std::string> lines;
+		auto handler = std::make_unique<Collect>(lines);
+		Collect *collect = handler.get();
+		Tial::Utility::Logger::addHandler(std::move(handler), {TIAL_MODULE});
+
+		Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Warning, TIAL_MODULE);
+		std::size_t dormant = Tial::Utility::Logger::dormantSites();
+		keyed(1);
+		Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Nice3, TIAL_MODULE);
+		std::size_t enabled = Tial::Utility::Logger::dormantSites();
+		keyed(2);
+		Tial::Utility::Logger::removeHandler(collect);
+
+		[[Check::Verify]] lines == std::vector<std::string>({"keyed 2"});
+#ifdef TIAL_UTILITY_LOGGER_STATIC_KEYS_ENABLED
+		[[Check::Verify]] dormant > enabled;
+#else
+		[[Check::Verify]] dormant == enabled;
+#endif
+	}
+};
+
+}
+}
+}
@@ -0,0 +1,207 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <TialTesting/TialTesting.hpp>
+#include <TialUtility/TialUtility.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+
+#define TIAL_MODULE "Tial::Utility::Metrics/Test"
+
+[[Tial::Testing::Typedef]] namespace Testing = Tial::Testing;
+[[Tial::Testing::Typedef]] namespace Check = Tial::Testing::Check;
+
+namespace [[Testing::Suite]] Tial {
+namespace [[Testing::Suite]] Utility {
+namespace [[Testing::Suite]] Metrics {
+
+class Collect: public Tial::Utility::Logger::Handler {
+public:
+	std::vector<std::string> &lines;
+
+	explicit Collect(std::vector<std::string> &lines): Handler(Tial::Utility::Logger::Level::Nice3), lines(lines) {}
+
+	virtual void write(const Tial::Utility::Logger::Message &message) override {
+		std::string line = message.stream.output();
+		message.stream.fields.forEach([&line](const Tial::Utility::Logger::Fields::Field &field) {
+			line += " " + field.key.to_string();
+		});
+		lines.push_back(line);
+	}
+};
+
+class [[Testing::Case]] ShardedCounter {
+	void operator()() {
+		const int threads = 4;
+		const int count = 10000;
+		Tial::Utility::Metrics::Counter counter(TIAL_MODULE, "counter");
+		Testing::Thread worker([&counter](){
+			for(int i = 0; i < count; ++i)
+				counter.add();
+		});
+		std::vector<Testing::Thread> workers(threads, worker);
+		for(int i = 0; i < threads; ++i)
+			workers[i]("worker");
+		for(auto &&thread: workers)
+			thread.join();
+		counter.add(5);
+		[[Check::Verify]] counter.value() == static_cast<uint64_t>(threads*count + 5);
+
+		Tial::Utility::Metrics::Gauge gauge(TIAL_MODULE, "gauge");
+		gauge.set(10);
+		gauge.add(-3);
+		[[Check::Verify]] gauge.value() == 7;
+	}
+};
+
+class [[Testing::Case]] HistogramPercentiles {
+	void operator()() {
+		Tial::Utility::Metrics::Histogram histogram(TIAL_MODULE, "histogram");
+		[[Check::Verify]] histogram.distribution().percentile(0.5) == 0u;
+		for(uint64_t value = 1; value <= 100; ++value)
+			histogram.record(value);
+		histogram.record(0);
+
+		auto distribution = histogram.distribution();
+		[[Check::Verify]] distribution.count == 101u;
+		[[Check::Verify]] distribution.sum == 5050u;
+		[[Check::Verify]] distribution.buckets[0] == 1u;
+		[[Check::Verify]] distribution.buckets[1] == 1u;
+		[[Check::Verify]] distribution.buckets[7] == 37u;
+		// bucket upper bounds: the median 50 lies in 32-63, the 99th percentile in 64-127
+		[[Check::Verify]] distribution.percentile(0.5) == 63u;
+		[[Check::Verify]] distribution.percentile(0.99) == 127u;
+		[[Check::Verify]] Tial::Utility::Metrics::Distribution::bucket(UINT64_MAX) == 64u;
+	}
+};
+
+class [[Testing::Case]] Snapshot {
+	void operator()() {
+		auto before = Tial::Utility::Metrics::snapshot(TIAL_MODULE);
+		[[Check::Verify]] before.empty();
+		{
+			Tial::Utility::Metrics::Counter second(TIAL_MODULE "::Sub", "b");
+			Tial::Utility::Metrics::Gauge first(TIAL_MODULE, "a");
+			Tial::Utility::Metrics::Counter other(TIAL_MODULE "Other", "c");
+			second.add(2);
+			first.set(-1);
+
+			auto samples = Tial::Utility::Metrics::snapshot(TIAL_MODULE);
+			[[Check::Verify]] samples.size() == 2u;
+			[[Check::Verify]] samples[0].name == "a";
+			[[Check::Verify]] samples[0].value == -1;
+			[[Check::Verify]] samples[1].module == TIAL_MODULE "::Sub";
+			[[Check::Verify]] Tial::Utility::Metrics::format(samples[1]) == TIAL_MODULE "::Sub b 2";
+		}
+		auto after = Tial::Utility::Metrics::snapshot(TIAL_MODULE);
+		[[Check::Verify]] after.empty();
+
+		// instrumentation of Directory::content
+		auto directory = Tial::Utility::Metrics::snapshot("Tial::Utility::Directory");
+		[[Check::Verify]] directory.size() == 2u;
+		uint64_t calls = directory[1].distribution.count;
+		uint64_t entries = static_cast<uint64_t>(directory[0].value);
+		Tial::Utility::NativeDirectory sample = Tial::Utility::NativeDirectory::current()/"sample";
+		sample.content();
+		directory = Tial::Utility::Metrics::snapshot("Tial::Utility::Directory");
+		[[Check::Verify]] directory[1].distribution.count == calls + 1;
+		uint64_t entriesAfter = static_cast<uint64_t>(directory[0].value);
+		[[Check::Verify]] entriesAfter == entries + 3;
+	}
+};
+
+class [[Testing::Case]] ShortLivedMetrics {
+	void operator()() {
+		const std::string module = TIAL_MODULE "::ShortLived";
+		std::atomic<int> reports{0};
+		{
+			// samples metrics while they are being constructed and destroyed
+			Tial::Utility::Metrics::Reporter reporter(std::chrono::milliseconds(0),
+					[&reports](const std::vector<Tial::Utility::Metrics::Sample>&) {
+				++reports;
+			}, module);
+			auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+			for(int i = 0; std::chrono::steady_clock::now() < deadline || i < 1000; ++i) {
+				Tial::Utility::Metrics::Counter counter(module, "counter");
+				Tial::Utility::Metrics::Gauge gauge(module, "gauge");
+				auto histogram = std::make_unique<Tial::Utility::Metrics::Histogram>(module, "histogram");
+				counter.add();
+				gauge.set(i);
+				histogram->record(static_cast<uint64_t>(i));
+				if(i % 16 == 0)
+					std::this_thread::yield();
+			}
+		}
+		[[Check::Verify]] reports.load() > 1;
+		[[Check::Verify]] Tial::Utility::Metrics::snapshot(module).empty();
+	}
+};
+
+class [[Testing::Case]] Reporters {
+	void operator()() {
+		Tial::Utility::Metrics::Counter counter(TIAL_MODULE, "reported");
+		counter.add(3);
+
+		std::vector<std::string> reported;
+		std::mutex mutex;
+		{
+			Tial::Utility::Metrics::Reporter reporter(std::chrono::milliseconds(1),
+					[&](const std::vector<Tial::Utility::Metrics::Sample> &samples) {
+				std::unique_lock<std::mutex> lock(mutex);
+				for(auto &&sample: samples)
+					reported.push_back(Tial::Utility::Metrics::format(sample));
+			}, TIAL_MODULE);
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		}
+		// periodic reports, and the last one from the destructor
+		[[Check::Verify]] reported.size() >= 2u;
+		[[Check::Verify]] reported.back() == TIAL_MODULE " reported 3";
+
+		std::vector<std::string> lines;
+		{
+			Tial::Utility::Metrics::Reporter reporter(std::chrono::hours(1), std::make_unique<Collect>(lines),
+				TIAL_MODULE);
+		}
+		std::vector<std::string> expectedLines{TIAL_MODULE " reported 3 module metric value"};
+		[[Check::Verify]] lines == expectedLines;
+
+		const std::string fileName = "TestMetrics.log";
+		std::remove(fileName.c_str());
+		{
+			Tial::Utility::Metrics::Reporter reporter(std::chrono::hours(1), fileName, TIAL_MODULE);
+			reporter.report();
+		}
+		std::ifstream file(fileName);
+		std::vector<std::string> fileLines;
+		for(std::string line; std::getline(file, line);)
+			fileLines.push_back(line);
+		[[Check::Verify]] fileLines.size() == 2u;
+		[[Check::Verify]] fileLines[1].substr(fileLines[1].find(' ') + 1) == TIAL_MODULE " reported 3";
+		std::remove(fileName.c_str());
+	}
+};
+
+}
+}
+}
@@ -0,0 +1,117 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <TialTesting/TialTesting.hpp>
+#include <TialUtility/TialUtility.hpp>
+
+#include <atomic>
+
+#define TIAL_MODULE "Tial::Utility::Rcu/Test"
+
+[[Tial::Testing::Typedef]] namespace Testing = Tial::Testing;
+[[Tial::Testing::Typedef]] namespace Check = Tial::Testing::Check;
+
+namespace [[Testing::Suite]] Tial {
+namespace [[Testing::Suite]] Utility {
+namespace [[Testing::Suite]] TestRcu {
+
+struct Value {
+	static std::atomic<int> alive;
+	int first;
+	int second;
+
+	Value(int first, int second): first(first), second(second) {
+		++alive;
+	}
+
+	~Value() {
+		first = -1;
+		second = -2;
+		--alive;
+	}
+};
+
+std::atomic<int> Value::alive{0};
+
+class [[Testing::Case]] Update {
+	void operator()() {
+		{
+			Tial::Utility::Rcu::Pointer<Value> pointer(std::make_unique<Value>(1, 1));
+			pointer.update([](const Value &value){ return std::make_unique<Value>(value.first+1, value.second+1); });
+			int first = 0;
+			{
+				Tial::Utility::Rcu::ReadSection section;
+				Tial::Utility::Rcu::ReadSection nested;
+				first = pointer.get()->first;
+			}
+			[[Check::Verify]] first == 2;
+			[[Check::Verify]] Value::alive == 1;
+		}
+		[[Check::Verify]] Value::alive == 0;
+	}
+};
+
+class [[Testing::Case]] ConcurrentReaders {
+	static constexpr int readers = 4;
+	static constexpr int updates = 2000;
+
+	void operator()() {
+		Tial::Utility::Rcu::Pointer<Value> pointer(std::make_unique<Value>(0, 0));
+		std::atomic<bool> done{false};
+		std::atomic<bool> consistent{true};
+
+		Testing::Thread reader([&](){
+			int last = 0;
+			while(!done.load()) {
+				Tial::Utility::Rcu::ReadSection section;
+				const Value *value = pointer.get();
+				int first = value->first;
+				std::this_thread::yield();
+				if(value->second != first || first < last)
+					consistent = false;
+				last = first;
+			}
+		});
+		std::vector<Testing::Thread> threads(readers, reader);
+		for(int i = 0; i < readers; ++i)
+			threads[i]("reader");
+
+		for(int i = 0; i < updates; ++i)
+			pointer.update([](const Value &value){ return std::make_unique<Value>(value.first+1, value.second+1); });
+		done = true;
+		for(auto &&thread: threads)
+			thread.join();
+
+		bool last = false;
+		{
+			Tial::Utility::Rcu::ReadSection section;
+			last = pointer.get()->first == updates;
+		}
+		[[Check::Verify]] consistent.load();
+		[[Check::Verify]] last;
+		[[Check::Verify]] Value::alive == 1;
+	}
+};
+
+}
+}
+}
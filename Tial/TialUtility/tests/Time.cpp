@@ -54,11 +54,13 @@ class [[Testing::Case]] TimeCast {
 		auto t = std::chrono::system_clock::from_time_t(timegm(&tt));
 		t += std::chrono::microseconds(dt.microsecond);
 		[[Check::Verify]] Tial::Utility::Time::timeCast(t, Tial::Utility::Time::Zone::UTC) == expected;
+		[[Check::Verify]] Tial::Utility::Time::formatTimestamp(t, Tial::Utility::Time::Zone::UTC) == expected;
 
 		// with local tz
 		t = std::chrono::system_clock::from_time_t(timelocal(&tt));
 		t += std::chrono::microseconds(dt.microsecond);
 		[[Check::Verify]] Tial::Utility::Time::timeCast(t, Tial::Utility::Time::Zone::Local) == expected;
+		[[Check::Verify]] Tial::Utility::Time::formatTimestamp(t, Tial::Utility::Time::Zone::Local) == expected;
 	}
 
 	void operator()() {
@@ -0,0 +1,150 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <TialTesting/TialTesting.hpp>
+#include <TialUtility/TialUtility.hpp>
+
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+#define TIAL_MODULE "Tial::Utility::Trace/Test"
+
+[[Tial::Testing::Typedef]] namespace Testing = Tial::Testing;
+[[Tial::Testing::Typedef]] namespace Check = Tial::Testing::Check;
+
+namespace [[Testing::Suite]] Tial {
+namespace [[Testing::Suite]] Utility {
+namespace [[Testing::Suite]] Trace {
+
+void work(int i) {
+	TIAL_TRACE_SCOPE("outer");
+	{
+		TIAL_TRACE_SCOPE("inner");
+		TIAL_TRACE_COUNTER("progress", i);
+	}
+}
+
+void discard() {
+	Tial::Utility::Trace::collect([](const std::string&, unsigned int, const Tial::Utility::Trace::Event&){});
+}
+
+class [[Testing::Case]] Spans {
+	void operator()() {
+		const int threads = 4;
+		// spans more than one chunk of the per-thread buffer
+		const int count = 1000;
+		discard();
+
+		Tial::Utility::Trace::start();
+		std::atomic<int> nextWorker{0};
+		Testing::Thread worker([&](){
+			Tial::Utility::Thread::setName("worker" + std::to_string(nextWorker++));
+			for(int i = 0; i < count; ++i)
+				work(i);
+		});
+		std::vector<Testing::Thread> workers(threads, worker);
+		for(int i = 0; i < threads; ++i)
+			workers[i]("worker");
+		for(auto &&thread: workers)
+			thread.join();
+		Tial::Utility::Trace::stop();
+		work(0);
+
+		std::map<std::string, std::vector<Tial::Utility::Trace::Event>> events;
+		std::size_t collected = Tial::Utility::Trace::collect([&events](const std::string &thread, unsigned int,
+				const Tial::Utility::Trace::Event &event) {
+			events[thread].push_back(event);
+		});
+
+		if(!Tial::Utility::Trace::compiled) {
+			[[Check::Verify]] collected == 0u;
+			return;
+		}
+		[[Check::Verify]] collected == static_cast<std::size_t>(threads*count*5);
+		[[Check::Verify]] events.size() == static_cast<std::size_t>(threads);
+
+		// every thread records outer and inner spans around the counter in order, with time not going back
+		const Tial::Utility::Trace::Phase phases[] = {
+			Tial::Utility::Trace::Phase::Begin, Tial::Utility::Trace::Phase::Begin,
+			Tial::Utility::Trace::Phase::Counter,
+			Tial::Utility::Trace::Phase::End, Tial::Utility::Trace::Phase::End
+		};
+		const std::string names[] = {"outer", "inner", "progress", "inner", "outer"};
+		bool ordered = true;
+		for(auto &&thread: events) {
+			int64_t time = 0;
+			for(std::size_t i = 0; i < thread.second.size(); ++i) {
+				const auto &event = thread.second[i];
+				ordered = ordered && event.phase == phases[i%5] && event.name == names[i%5] && event.time >= time;
+				ordered = ordered && (event.phase != Tial::Utility::Trace::Phase::Counter
+					|| event.value == static_cast<int64_t>(i/5));
+				time = event.time;
+			}
+		}
+		[[Check::Verify]] ordered;
+
+		// buffers of exited threads are released once drained
+		std::size_t remaining = 0;
+		Tial::Utility::Trace::collect([&remaining](const std::string&, unsigned int,
+			const Tial::Utility::Trace::Event&){ ++remaining; });
+		[[Check::Verify]] remaining == 0u;
+	}
+};
+
+class [[Testing::Case]] ChromeTrace {
+	void operator()() {
+		discard();
+		// the name the thread has when collected is the one written
+		Tial::Utility::Thread::setName("renamed");
+		Tial::Utility::Trace::start();
+		work(1);
+		Tial::Utility::Thread::setName("main");
+		work(7);
+		Tial::Utility::Trace::stop();
+
+		std::ostringstream stream;
+		Tial::Utility::Trace::writeChromeTrace(stream);
+		std::string json = stream.str();
+		stream << std::setw(3) << 7;
+		bool fillKept = stream.str().substr(json.size()) == "  7";
+
+		bool document = json.find("\"traceEvents\":[") == 1;
+		bool threadName = json.find("\"name\":\"thread_name\",\"ph\":\"M\"") != std::string::npos
+			&& json.find("\"name\":\"main\"") != std::string::npos
+			&& json.find("\"name\":\"renamed\"") == std::string::npos;
+		bool begin = json.find("\"name\":\"outer\",\"ph\":\"B\"") != std::string::npos;
+		bool end = json.find("\"name\":\"outer\",\"ph\":\"E\"") != std::string::npos;
+		bool counter = json.find("\"value\":7") != std::string::npos;
+		bool compiled = Tial::Utility::Trace::compiled;
+		[[Check::Verify]] document;
+		[[Check::Verify]] fillKept;
+		[[Check::Verify]] threadName == compiled;
+		[[Check::Verify]] begin == compiled;
+		[[Check::Verify]] end == compiled;
+		[[Check::Verify]] counter == compiled;
+	}
+};
+
+}
+}
+}
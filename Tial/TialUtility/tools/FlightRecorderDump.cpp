@@ -0,0 +1,45 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "../Logger.hpp"
+
+#include <cstdlib>
+#include <iostream>
+
+int main(int argc, char **argv) {
+	if(argc != 2 && argc != 3) {
+		std::cerr << "Usage: " << argv[0] << " <flight recorder file> [newest megabytes]" << std::endl;
+		return 1;
+	}
+
+	try {
+		std::size_t bytes = argc == 3 ? static_cast<std::size_t>(std::atof(argv[2])*1024*1024) : 0;
+		Tial::Utility::Logger::Handlers::FlightRecorder::decode(argv[1], [](const Tial::Utility::Logger::Message &message) {
+			std::cout << Tial::Utility::Logger::Handlers::File::format(message);
+		}, bytes);
+	} catch(const std::exception &e) {
+		std::cout.flush();
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
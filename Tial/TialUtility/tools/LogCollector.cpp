@@ -0,0 +1,65 @@
+/* Copyright (c) 2015, Mariusz Plucinski
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted
+ * provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions
+ *    and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of
+ *    conditions and the following disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "../Logger.hpp"
+
+#include <csignal>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+volatile std::sig_atomic_t stopping = 0;
+
+void stop(int) {
+	stopping = 1;
+}
+
+}
+
+int main(int argc, char **argv) {
+	if(argc != 3) {
+		std::cerr << "Usage: " << argv[0] << " <shared ring name> <log file>" << std::endl;
+		return 1;
+	}
+	std::signal(SIGINT, stop);
+	std::signal(SIGTERM, stop);
+
+	try {
+		typedef Tial::Utility::Logger::Handlers::SharedRing SharedRing;
+		SharedRing::Collector collector(argv[1]);
+		Tial::Utility::Logger::Handlers::File file(Tial::Utility::Logger::Level::Nice3, argv[2]);
+		while(!stopping) {
+			if(!collector.drain(file)) {
+				file.idle();
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+		}
+		while(collector.drain(file));
+		if(uint64_t dropped = collector.dropped())
+			std::cerr << dropped << " messages were dropped" << std::endl;
+	} catch(const std::exception &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}